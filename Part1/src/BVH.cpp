@@ -0,0 +1,421 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Build parameters
+static const int BIN_COUNT = 16;        // SAH candidate split planes per axis
+static const int MAX_LEAF_SIZE = 8;     // larger ranges are always split
+static const int MAX_DEPTH = 60;        // bounded by the traversal stack below
+static const float TRAVERSAL_COST = 1.0f;  // relative to one primitive test
+static const int STACK_SIZE = 64;
+
+// Slab test: entry distance (in units of the ray direction) into the box
+// fmin/fmax drop the NaN produced when the origin lies on an axis-parallel slab
+static bool intersectBox(const Vec3& lo, const Vec3& hi, const Vec3& origin,
+                         const Vec3& invDir, float& tNear) {
+    Vec3 t0 = (lo - origin) * invDir;
+    Vec3 t1 = (hi - origin) * invDir;
+    tNear = std::fmax(std::fmax(std::fmin(t0.x, t1.x), std::fmin(t0.y, t1.y)), std::fmin(t0.z, t1.z));
+    float tFar = std::fmin(std::fmin(std::fmax(t0.x, t1.x), std::fmax(t0.y, t1.y)), std::fmax(t0.z, t1.z));
+    return tFar >= std::fmax(tNear, 0.0f);
+}
+
+// Constructor: split surfaces into spheres (hierarchy) and planes (side list)
+BVH::BVH(const Surface* surfaces, int count) : surfaces(surfaces) {
+    std::vector<AABB> boxes;
+    std::vector<Vec3> centers;
+    for (int i = 0; i < count; ++i) {
+        const Surface& surface = surfaces[i];
+        if (surface.is_plane()) {
+            ownedPlanes.push_back((uint32_t)i);
+            continue;
+        }
+        // Bounding box: cube of half-size radius around the center
+        AABB box;
+        box.lo = surface.point - Vec3(surface.radius);
+        box.hi = surface.point + Vec3(surface.radius);
+        ownedSphereOrder.push_back((uint32_t)i);
+        boxes.push_back(box);
+        centers.push_back(box.center());
+    }
+
+    if (!ownedSphereOrder.empty()) {
+        ownedNodes.reserve(2 * ownedSphereOrder.size());
+        buildNode(boxes, centers, 0, (int)ownedSphereOrder.size(), 0);
+    }
+
+    // Lay the spheres out in leaf order
+    for (uint32_t index : ownedSphereOrder) spheres.add(surfaces[index].point, surfaces[index].radius);
+    ownedLayout.resize(SphereBlock::layoutSize(spheres.size()));
+    spheres.copyLayout(ownedLayout.data());
+
+    arrays.nodes = ownedNodes.data();
+    arrays.nodeCount = (int)ownedNodes.size();
+    arrays.sphereOrder = ownedSphereOrder.data();
+    arrays.sphereCount = (int)ownedSphereOrder.size();
+    arrays.planes = ownedPlanes.data();
+    arrays.planeCount = (int)ownedPlanes.size();
+    arrays.sphereLayout = ownedLayout.data();
+    spheres.view(arrays.sphereLayout, arrays.sphereCount);
+}
+
+// Constructor: nothing is built or copied
+BVH::BVH(const Surface* surfaces, const Arrays& arrays) : surfaces(surfaces), arrays(arrays) {
+    spheres.view(arrays.sphereLayout, arrays.sphereCount);
+}
+
+// Walks the whole tree once (iteratively), checking every node
+bool BVH::isValid(const Arrays& arrays, const Surface* surfaces, int surfaceCount) {
+    if (arrays.nodeCount < 0 || arrays.sphereCount < 0 || arrays.planeCount < 0) return false;
+    for (int i = 0; i < arrays.sphereCount; ++i) {
+        uint32_t index = arrays.sphereOrder[i];
+        if (index >= (uint32_t)surfaceCount || surfaces[index].kind != SPHERE_PRIMITIVE) return false;
+    }
+    for (int i = 0; i < arrays.planeCount; ++i) {
+        uint32_t index = arrays.planes[i];
+        if (index >= (uint32_t)surfaceCount || surfaces[index].kind != PLANE_PRIMITIVE) return false;
+    }
+    if (arrays.nodeCount == 0) return arrays.sphereCount == 0;
+
+    // Every node must be reached exactly once, with children after their parent
+    struct Entry { int node; int depth; };
+    std::vector<Entry> stack = {{0, 0}};
+    int visited = 0;
+    while (!stack.empty()) {
+        Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.depth > MAX_DEPTH) return false;
+        ++visited;
+
+        const Node& node = arrays.nodes[entry.node];
+        if (node.count < 0) return false;
+        if (node.count > 0) {
+            if (node.rightOrFirst < 0 || node.rightOrFirst > arrays.sphereCount - node.count) return false;
+            continue;
+        }
+        int left = entry.node + 1, right = node.rightOrFirst;
+        if (left >= arrays.nodeCount || right <= left || right >= arrays.nodeCount) return false;
+        stack.push_back({right, entry.depth + 1});
+        stack.push_back({left, entry.depth + 1});
+        if (visited + (int)stack.size() > arrays.nodeCount) return false;
+    }
+    return visited == arrays.nodeCount;
+}
+
+// Recursively build the subtree over lanes [first, first + count) of ownedSphereOrder
+// Returns the index of the created node
+int BVH::buildNode(std::vector<AABB>& boxes, std::vector<Vec3>& centers, int first, int count, int depth) {
+    AABB bounds, centerBounds;
+    for (int i = first; i < first + count; ++i) {
+        bounds.grow(boxes[i]);
+        centerBounds.grow(centers[i]);
+    }
+
+    int index = (int)ownedNodes.size();
+    ownedNodes.push_back({bounds.lo, first, bounds.hi, count});
+    if (count == 1 || depth >= MAX_DEPTH) return index;
+
+    // Binned SAH: find the cheapest split plane over all three axes
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestAxis = -1, bestBin = 0;
+    Vec3 extent = centerBounds.hi - centerBounds.lo;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f) continue;
+
+        AABB binBoxes[BIN_COUNT];
+        int binCounts[BIN_COUNT] = {0};
+        float scale = BIN_COUNT / extent[axis];
+        for (int i = first; i < first + count; ++i) {
+            int bin = std::min(BIN_COUNT - 1, (int)((centers[i][axis] - centerBounds.lo[axis]) * scale));
+            binBoxes[bin].grow(boxes[i]);
+            binCounts[bin]++;
+        }
+
+        // Sweep from the right to get the cost of every "bins [0, b) | [b, N)" split
+        float rightArea[BIN_COUNT];
+        int rightCount[BIN_COUNT];
+        AABB rightBox;
+        int rightSum = 0;
+        for (int b = BIN_COUNT - 1; b > 0; --b) {
+            rightBox.grow(binBoxes[b]);
+            rightSum += binCounts[b];
+            rightArea[b] = rightBox.halfArea();
+            rightCount[b] = rightSum;
+        }
+        AABB leftBox;
+        int leftSum = 0;
+        for (int b = 1; b < BIN_COUNT; ++b) {
+            leftBox.grow(binBoxes[b - 1]);
+            leftSum += binCounts[b - 1];
+            if (leftSum == 0 || rightCount[b] == 0) continue;
+            float cost = leftSum * leftBox.halfArea() + rightCount[b] * rightArea[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    int mid;
+    if (bestAxis < 0) {
+        // All centers coincide: no plane separates them
+        if (count <= MAX_LEAF_SIZE) return index;
+        mid = first + count / 2;
+    } else {
+        float splitCost = TRAVERSAL_COST + bestCost / bounds.halfArea();
+        if (splitCost >= (float)count && count <= MAX_LEAF_SIZE) return index;
+
+        float scale = BIN_COUNT / extent[bestAxis];
+        mid = first;
+        for (int i = first; i < first + count; ++i) {
+            int bin = std::min(BIN_COUNT - 1, (int)((centers[i][bestAxis] - centerBounds.lo[bestAxis]) * scale));
+            if (bin < bestBin) {
+                std::swap(ownedSphereOrder[i], ownedSphereOrder[mid]);
+                std::swap(boxes[i], boxes[mid]);
+                std::swap(centers[i], centers[mid]);
+                ++mid;
+            }
+        }
+    }
+
+    // Interior node: left child follows directly, right child index is stored
+    ownedNodes[index].count = 0;
+    buildNode(boxes, centers, first, mid - first, depth + 1);
+    int right = buildNode(boxes, centers, mid, first + count - mid, depth + 1);
+    ownedNodes[index].rightOrFirst = right;
+    return index;
+}
+
+// Closest hit: planes first, then front-to-back traversal that skips nodes
+// whose entry distance is already beyond the closest hit found so far
+bool BVH::closestHit(const RayCast& ray, float tmin, HitResult& hit) const {
+    for (int i = 0; i < arrays.planeCount; ++i) planeAt(i)->intersect(ray, tmin, hit);
+    if (arrays.nodeCount == 0) return hit.is_hit();
+    const Node* nodes = arrays.nodes;
+
+    const Vec3& origin = ray.getOrigin();
+    const Vec3 invDir = 1.0f / ray.getDirection();
+
+    struct Entry { int node; float tNear; };
+    Entry stack[STACK_SIZE];
+    int top = 0;
+    float rootNear;
+    if (intersectBox(nodes[0].lo, nodes[0].hi, origin, invDir, rootNear)) stack[top++] = {0, rootNear};
+
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.tNear >= hit.get_t()) continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0) {
+            float tmax = hit.get_t();
+            int lane = spheres.closestHit(origin, ray.getDirection(), node.rightOrFirst, node.count, tmin, tmax);
+            if (lane >= 0) hit.record(tmax, sphereAt(lane));
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited next
+        int left = entry.node + 1, right = node.rightOrFirst;
+        float leftNear, rightNear;
+        bool hitLeft = intersectBox(nodes[left].lo, nodes[left].hi, origin, invDir, leftNear);
+        bool hitRight = intersectBox(nodes[right].lo, nodes[right].hi, origin, invDir, rightNear);
+        if (hitLeft && hitRight) {
+            if (leftNear < rightNear) {
+                stack[top++] = {right, rightNear};
+                stack[top++] = {left, leftNear};
+            } else {
+                stack[top++] = {left, leftNear};
+                stack[top++] = {right, rightNear};
+            }
+        } else if (hitLeft) {
+            stack[top++] = {left, leftNear};
+        } else if (hitRight) {
+            stack[top++] = {right, rightNear};
+        }
+    }
+    return hit.is_hit();
+}
+
+// Packet closest hit: planes per lane, then one traversal for the whole packet.
+// Lanes that leave a box (or already have a closer hit) are masked off below it.
+void BVH::closestHitPacket(const RayPacket& packet, float tmin, PacketHit& hit) const {
+    if (!packetKernelsAvailable()) {
+        // No SIMD lanes: trace the packet ray by ray
+        for (int lane = 0; lane < RayPacket::SIZE; ++lane) {
+            if (!(packet.activeMask & (1 << lane))) continue;
+            HitResult single(hit.t[lane]);
+            if (closestHit(RayCast(packet.origin, packet.direction(lane)), tmin, single)) {
+                hit.t[lane] = single.get_t();
+                hit.prim[lane] = single.get_object();
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < arrays.planeCount; ++i) {
+        const Surface* plane = planeAt(i);
+        for (int lane = 0; lane < RayPacket::SIZE; ++lane) {
+            if (!(packet.activeMask & (1 << lane))) continue;
+            HitResult single(hit.t[lane]);
+            if (plane->intersect(RayCast(packet.origin, packet.direction(lane)), tmin, single)) {
+                hit.t[lane] = single.get_t();
+                hit.prim[lane] = plane;
+            }
+        }
+    }
+    if (arrays.nodeCount == 0) return;
+    const Node* nodes = arrays.nodes;
+
+    // Representative direction (first active lane) orders the children front-to-back
+    Vec3 mainDir(0.0f);
+    for (int lane = 0; lane < RayPacket::SIZE; ++lane) {
+        if (packet.activeMask & (1 << lane)) { mainDir = packet.direction(lane); break; }
+    }
+
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const int index = stack[--top];
+        const Node& node = nodes[index];
+        int mask = packetIntersectBox(packet, node.lo, node.hi, hit.t, packet.activeMask);
+        if (mask == 0) continue;
+
+        if (node.count > 0) {
+            for (int i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i) {
+                int closer = packetIntersectSphere(packet, spheres.center(i), spheres.radiusSq(i), tmin, hit.t, mask);
+                for (int lane = 0; closer != 0; ++lane, closer >>= 1) {
+                    if (closer & 1) hit.prim[lane] = sphereAt(i);
+                }
+            }
+            continue;
+        }
+
+        int left = index + 1, right = node.rightOrFirst;
+        Vec3 leftCenter = (nodes[left].lo + nodes[left].hi) * 0.5f;
+        Vec3 rightCenter = (nodes[right].lo + nodes[right].hi) * 0.5f;
+        if (glm::dot(mainDir, rightCenter - leftCenter) < 0.0f) std::swap(left, right);
+        stack[top++] = right;
+        stack[top++] = left;
+    }
+}
+
+// Shadow test: any primitive hit inside (tmin, tmax) occludes
+bool BVH::isOccluded(const RayCast& ray, float tmin, float tmax) const {
+    return findOccluder(ray, tmin, tmax) != NO_OCCLUDER;
+}
+
+// Visit order does not matter for an any-hit query, so children are pushed
+// without sorting and the first leaf with a hit ends the traversal
+uint32_t BVH::findOccluder(const RayCast& ray, float tmin, float tmax) const {
+    for (int i = 0; i < arrays.planeCount; ++i) {
+        if (planeAt(i)->occludes(ray, tmin, tmax)) return (uint32_t)(arrays.sphereCount + i);
+    }
+    if (arrays.nodeCount == 0) return NO_OCCLUDER;
+    const Node* nodes = arrays.nodes;
+
+    const Vec3& origin = ray.getOrigin();
+    const Vec3 invDir = 1.0f / ray.getDirection();
+
+    int stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const int index = stack[--top];
+        const Node& node = nodes[index];
+        float tNear;
+        if (!intersectBox(node.lo, node.hi, origin, invDir, tNear) || tNear >= tmax) continue;
+
+        if (node.count > 0) {
+            int lane = spheres.firstOccluder(origin, ray.getDirection(), node.rightOrFirst, node.count, tmin, tmax);
+            if (lane >= 0) return (uint32_t)lane;
+            continue;
+        }
+        stack[top++] = node.rightOrFirst;
+        stack[top++] = index + 1;
+    }
+    return NO_OCCLUDER;
+}
+
+bool BVH::occludedBy(uint32_t id, const RayCast& ray, float tmin, float tmax) const {
+    if (id < (uint32_t)arrays.sphereCount) {
+        return spheres.anyHit(ray.getOrigin(), ray.getDirection(), (int)id, 1, tmin, tmax);
+    }
+    id -= (uint32_t)arrays.sphereCount;
+    return id < (uint32_t)arrays.planeCount && planeAt((int)id)->occludes(ray, tmin, tmax);
+}
+
+// Batched shadow test: the stack carries the rays still to be tested below
+// each node, so a subtree is visited once for all the lights whose rays enter
+// it (their slab tests run side by side in SIMD lanes), and the walk ends as
+// soon as every ray is blocked
+uint32_t BVH::occludedMask(const ShadowBatch& batch, float tmin, uint32_t* occluders) const {
+    const uint32_t all = (batch.count >= 32) ? 0xffffffffu : ((1u << batch.count) - 1);
+    uint32_t occluded = 0;
+
+    // Likely blockers first: one primitive test per ray
+    if (occluders) {
+        for (int ray = 0; ray < batch.count; ++ray) {
+            if (occluders[ray] != NO_OCCLUDER &&
+                occludedBy(occluders[ray], RayCast(batch.origin(ray), batch.direction(ray)), tmin, batch.tmax[ray])) {
+                occluded |= 1u << ray;
+            }
+        }
+    }
+
+    if (!packetKernelsAvailable()) {
+        // No SIMD lanes: test the rays one by one
+        for (int ray = 0; ray < batch.count; ++ray) {
+            if (occluded & (1u << ray)) continue;
+            const uint32_t id = findOccluder(RayCast(batch.origin(ray), batch.direction(ray)), tmin, batch.tmax[ray]);
+            if (id != NO_OCCLUDER) {
+                occluded |= 1u << ray;
+                if (occluders) occluders[ray] = id;
+            }
+        }
+        return occluded;
+    }
+
+    for (int i = 0; i < arrays.planeCount && occluded != all; ++i) {
+        for (int ray = 0; ray < batch.count; ++ray) {
+            if (occluded & (1u << ray)) continue;
+            if (planeAt(i)->occludes(RayCast(batch.origin(ray), batch.direction(ray)), tmin, batch.tmax[ray])) {
+                occluded |= 1u << ray;
+                if (occluders) occluders[ray] = (uint32_t)(arrays.sphereCount + i);
+            }
+        }
+    }
+    if (arrays.nodeCount == 0 || occluded == all) return occluded;
+    const Node* nodes = arrays.nodes;
+
+    struct Entry {
+        int node;
+        uint32_t rays;
+    };
+    Entry stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = {0, all & ~occluded};
+    while (top > 0 && occluded != all) {
+        const Entry entry = stack[--top];
+        const Node& node = nodes[entry.node];
+        const uint32_t entering = shadowIntersectBox(batch, node.lo, node.hi, entry.rays & ~occluded);
+        if (entering == 0) continue;
+
+        if (node.count > 0) {
+            for (int ray = 0; ray < batch.count; ++ray) {
+                if (!(entering & (1u << ray))) continue;
+                int lane = spheres.firstOccluder(batch.origin(ray), batch.direction(ray), node.rightOrFirst,
+                                                 node.count, tmin, batch.tmax[ray]);
+                if (lane < 0) continue;
+                occluded |= 1u << ray;
+                if (occluders) occluders[ray] = (uint32_t)lane;
+            }
+            continue;
+        }
+        stack[top++] = {node.rightOrFirst, entering};
+        stack[top++] = {entry.node + 1, entering};
+    }
+    return occluded;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "Surface.h"
+#include "RayCast.h"
+#include "SphereBlock.h"
+#include "RayPacket.h"
+
+// Axis-aligned bounding box
+struct AABB {
+    Vec3 lo = Vec3(std::numeric_limits<float>::infinity());
+    Vec3 hi = Vec3(-std::numeric_limits<float>::infinity());
+
+    // Enlarge to contain a point or another box
+    void grow(const Vec3& p) { lo = glm::min(lo, p); hi = glm::max(hi, p); }
+    void grow(const AABB& b) { lo = glm::min(lo, b.lo); hi = glm::max(hi, b.hi); }
+
+    // Half of the surface area (enough for SAH cost comparisons)
+    float halfArea() const {
+        Vec3 e = glm::max(hi - lo, Vec3(0.0f));
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    Vec3 center() const { return (lo + hi) * 0.5f; }
+};
+
+// Bounding volume hierarchy over the scene's bounded surfaces (spheres), built
+// with the surface area heuristic (binned). Spheres are stored in leaf order in a
+// SphereBlock, so each leaf is a contiguous lane range tested by the SIMD kernel.
+// Unbounded primitives (planes) cannot be put in a box, so they are kept in a
+// small side list that every query tests linearly.
+// Both lists hold a single kind of surface, so no query dispatches on the kind.
+// All data lives in flat arrays (see Arrays): built and owned by the BVH, or
+// viewed in place, e.g. in a memory-mapped scene file.
+class BVH {
+public:
+    // 32-byte node: interior nodes keep their left child right after them and
+    // store the right child index; leaves store a range of sphere lanes
+    struct Node {
+        Vec3 lo;
+        int rightOrFirst;  // interior: right child index, leaf: first lane
+        Vec3 hi;
+        int count;         // 0 for interior nodes, sphere count for leaves
+    };
+
+    // Flat arrays of a BVH; indices refer to the scene's surface array
+    struct Arrays {
+        const Node* nodes = nullptr;
+        int nodeCount = 0;
+        const uint32_t* sphereOrder = nullptr;  // lane -> surface index (leaf order)
+        int sphereCount = 0;
+        const uint32_t* planes = nullptr;       // surface indices of the planes
+        int planeCount = 0;
+        const float* sphereLayout = nullptr;    // SphereBlock layout of the lanes
+    };
+
+    // Constructor: build the hierarchy over surfaces[0, count)
+    // (the surfaces must outlive the BVH, which points into them)
+    BVH(const Surface* surfaces, int count);
+
+    // Constructor: use prebuilt arrays in place (they must outlive the BVH;
+    // check them with isValid first if they come from a file)
+    BVH(const Surface* surfaces, const Arrays& arrays);
+
+    // Queries point into the arrays, so a BVH is not copied
+    BVH(const BVH&) = delete;
+    BVH& operator=(const BVH&) = delete;
+
+    // Whether arrays describe a well-formed tree over surfaces[0, surfaceCount):
+    // indices in range and of the right kind, leaf ranges inside the lanes,
+    // children after their parent and no deeper than traversal supports
+    static bool isValid(const Arrays& arrays, const Surface* surfaces, int surfaceCount);
+
+    // Find closest intersection inside (tmin, hit.get_t()); hit is left unresolved
+    bool closestHit(const RayCast& ray, float tmin, HitResult& hit) const;
+
+    // Closest hits of all active packet lanes inside (tmin, hit.t[lane]).
+    // The packet walks the tree once; a node is entered if any lane's ray enters it.
+    void closestHitPacket(const RayPacket& packet, float tmin, PacketHit& hit) const;
+
+    // Any-hit query for shadow rays: stops at the first primitive hit inside
+    // (tmin, tmax) and never builds a hit record; tmax may be infinite
+    bool isOccluded(const RayCast& ray, float tmin, float tmax) const;
+
+    // Occluder ids name a primitive for occludedMask: sphere lanes, then planes
+    static constexpr uint32_t NO_OCCLUDER = 0xffffffffu;
+
+    // isOccluded for every ray of batch in one walk of the tree: a node is
+    // entered with the rays that reach it and are not yet blocked. Bit i of
+    // the result is set if ray i is occluded (the same answer as isOccluded).
+    // With occluders, occluders[i] is an id to test ray i against before the
+    // walk (a likely blocker, or NO_OCCLUDER); rays it blocks skip the walk.
+    // occluders[i] then receives the id of the primitive that blocked ray i.
+    uint32_t occludedMask(const ShadowBatch& batch, float tmin, uint32_t* occluders = nullptr) const;
+
+    int getNodeCount() const { return arrays.nodeCount; }
+    const Arrays& getArrays() const { return arrays; }
+
+private:
+    const Surface* surfaces;
+    Arrays arrays;             // what the queries read
+    SphereBlock spheres;       // SoA lanes for the intersection kernel
+
+    // Storage behind arrays when the BVH was built here
+    std::vector<Node> ownedNodes;
+    std::vector<uint32_t> ownedSphereOrder;
+    std::vector<uint32_t> ownedPlanes;
+    std::vector<float> ownedLayout;
+
+    // Surface of sphere lane i / of side-list entry i
+    const Surface* sphereAt(int lane) const { return surfaces + arrays.sphereOrder[lane]; }
+    const Surface* planeAt(int i) const { return surfaces + arrays.planes[i]; }
+
+    // Whether occluder id blocks ray inside (tmin, tmax) (same tests as the walk)
+    bool occludedBy(uint32_t id, const RayCast& ray, float tmin, float tmax) const;
+
+    // The first primitive found to block ray inside (tmin, tmax), or NO_OCCLUDER
+    uint32_t findOccluder(const RayCast& ray, float tmin, float tmax) const;
+
+    int buildNode(std::vector<AABB>& boxes, std::vector<Vec3>& centers, int first, int count, int depth);
+};
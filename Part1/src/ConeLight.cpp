@@ -2,4 +2,4 @@
 
 // Constructor: initialize with direction (position and angle set later)
 ConeLight::ConeLight(const Vec3& dir) 
-    : Illumination(dir), lightPosition(0.0f), coneAngle(-1.0f), positionSet(false) {}
+    : Illumination(CONE_LIGHT, dir), lightPosition(0.0f), coneAngle(-1.0f), positionSet(false) {}
@@ -2,7 +2,7 @@
 #include <vector>
 
 // Cone/spotlight: emits light from a position within a cone angle
-class ConeLight : public Illumination
+class ConeLight final : public Illumination
 {
     private:
         Vec3 lightPosition;   // World position of light source
@@ -23,8 +23,4 @@ class ConeLight : public Illumination
 
         // Check if position is set
         bool hasPosition() const { return positionSet; }
-
-        // Type queries
-        bool isConeType() override { return true; }
-        bool isGlobalType() override { return false; }
 };
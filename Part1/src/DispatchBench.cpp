@@ -0,0 +1,188 @@
+// Micro-benchmark: virtual dispatch + dynamic_cast (the old Primitive/Illumination
+// protocol) against the kind-tag dispatch of the compiled Surface/LightSource
+// records now used by the renderer.
+// Build and run with `make bench`.
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <cstdlib>
+
+#include "Primitive.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "Illumination.h"
+#include "ParallelLight.h"
+#include "ConeLight.h"
+#include "RayCast.h"
+#include "HitResult.h"
+#include "SceneSnapshot.h"
+
+using namespace std;
+
+// ============================================================================
+// OLD PROTOCOL: abstract base with virtual queries, type tests by dynamic_cast
+// ============================================================================
+
+struct VirtualPrimitive {
+    virtual ~VirtualPrimitive() = default;
+    virtual bool intersect(const RayCast& ray, float tmin, HitResult& hit) = 0;
+    virtual Vec3 get_normal(const Vec3& p) const = 0;
+};
+
+struct VirtualSphere : VirtualPrimitive {
+    Surface shape;
+    explicit VirtualSphere(const Surface& s) : shape(s) {}
+    bool intersect(const RayCast& ray, float tmin, HitResult& hit) override { return shape.intersect(ray, tmin, hit); }
+    Vec3 get_normal(const Vec3& p) const override { return shape.get_normal(p); }
+};
+
+struct VirtualPlane : VirtualPrimitive {
+    Surface shape;
+    explicit VirtualPlane(const Surface& p) : shape(p) {}
+    bool intersect(const RayCast& ray, float tmin, HitResult& hit) override { return shape.intersect(ray, tmin, hit); }
+    Vec3 get_normal(const Vec3& p) const override { return shape.get_normal(p); }
+};
+
+struct VirtualLight {
+    virtual ~VirtualLight() = default;
+    virtual const Vec3& getDirection() const = 0;
+};
+
+struct VirtualParallelLight : VirtualLight {
+    ParallelLight light;
+    explicit VirtualParallelLight(const Vec3& d) : light(d) {}
+    const Vec3& getDirection() const override { return light.getDirection(); }
+};
+
+struct VirtualConeLight : VirtualLight {
+    ConeLight light;
+    explicit VirtualConeLight(const Vec3& d) : light(d) {}
+    const Vec3& getDirection() const override { return light.getDirection(); }
+};
+
+// ============================================================================
+// WORKLOAD: every ray tests every primitive, then shades against every light
+// ============================================================================
+
+// Random primitives with planes mixed in, so the type branch is not trivially predicted
+static void buildScene(int count, vector<Primitive*>& objects, vector<Illumination*>& lights) {
+    mt19937 rng(7);
+    uniform_real_distribution<float> pos(-4.0f, 4.0f), rad(0.05f, 0.4f);
+    for (int i = 0; i < count; ++i) {
+        if (i % 8 == 3) objects.push_back(new Plane(Vec3(0.0f, pos(rng), 1.0f), -8.0f + pos(rng), STANDARD));
+        else objects.push_back(new Sphere(Vec3(pos(rng), pos(rng), -6.0f + pos(rng)), rad(rng), STANDARD));
+    }
+    lights.push_back(new ParallelLight(Vec3(0.0f, -0.5f, -1.0f)));
+    ConeLight* cone = new ConeLight(Vec3(0.0f, 0.0f, -1.0f));
+    cone->setPosition(Vec3(0.0f, 2.0f, 0.0f));
+    cone->setAngle(0.6f);
+    lights.push_back(cone);
+}
+
+static vector<RayCast> buildRays(int count) {
+    mt19937 rng(11);
+    uniform_real_distribution<float> offset(-0.6f, 0.6f);
+    vector<RayCast> rays;
+    for (int i = 0; i < count; ++i) {
+        rays.emplace_back(Vec3(0.0f, 0.0f, 1.0f), glm::normalize(Vec3(offset(rng), offset(rng), -1.0f)));
+    }
+    return rays;
+}
+
+// Old protocol: virtual intersect/get_normal, dynamic_cast for plane and cone tests
+static float traceVirtual(const vector<RayCast>& rays, const vector<VirtualPrimitive*>& objects,
+                          const vector<VirtualLight*>& lights) {
+    float sum = 0.0f;
+    for (const RayCast& ray : rays) {
+        HitResult hit;
+        VirtualPrimitive* closest = nullptr;
+        for (VirtualPrimitive* obj : objects) {
+            if (obj->intersect(ray, 0.001f, hit)) closest = obj;
+        }
+        if (!closest) continue;
+        Vec3 pt = ray.pointAt(hit.get_t());
+        sum += closest->get_normal(pt).z;
+        if (dynamic_cast<VirtualPlane*>(closest)) sum += 1.0f;
+        for (VirtualLight* light : lights) {
+            if (auto* cone = dynamic_cast<VirtualConeLight*>(light)) sum += cone->light.getAngle();
+            else sum += light->getDirection().y;
+        }
+    }
+    return sum;
+}
+
+// Tagged protocol: the same work on the compiled records, as the renderer does it
+static float traceTagged(const vector<RayCast>& rays, ArrayView<Surface> surfaces,
+                         ArrayView<LightSource> lights) {
+    float sum = 0.0f;
+    for (const RayCast& ray : rays) {
+        HitResult hit;
+        for (const Surface& surface : surfaces) surface.intersect(ray, 0.001f, hit);
+        if (!hit.is_hit()) continue;
+        const Surface* closest = hit.get_object();
+        Vec3 pt = ray.pointAt(hit.get_t());
+        sum += closest->get_normal(pt).z;
+        if (closest->is_plane()) sum += 1.0f;
+        for (const LightSource& light : lights) {
+            if (light.isConeType()) sum += light.cosCutoff;
+            else sum += -light.direction.y;
+        }
+    }
+    return sum;
+}
+
+// Best of several runs, in nanoseconds per primitive test
+template <typename Body>
+static double timeRuns(int runs, long long tests, const Body& body, float& checksum) {
+    double best = numeric_limits<double>::infinity();
+    for (int i = 0; i < runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        checksum = body();
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count() / tests);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int primitiveCount = argc > 1 ? atoi(argv[1]) : 256;
+    int rayCount = argc > 2 ? atoi(argv[2]) : 20000;
+    const int runs = 5;
+
+    vector<Primitive*> objects;
+    vector<Illumination*> lights;
+    buildScene(primitiveCount, objects, lights);
+    vector<RayCast> rays = buildRays(rayCount);
+    SceneSnapshot scene(objects, lights, Vec3(0.0f), CameraBasis());
+
+    // Same shapes behind the old interface
+    vector<VirtualPrimitive*> virtualObjects;
+    for (const Surface& surface : scene.getSurfaces()) {
+        if (surface.is_plane()) virtualObjects.push_back(new VirtualPlane(surface));
+        else virtualObjects.push_back(new VirtualSphere(surface));
+    }
+    vector<VirtualLight*> virtualLights;
+    virtualLights.push_back(new VirtualParallelLight(Vec3(0.0f, -0.5f, -1.0f)));
+    VirtualConeLight* cone = new VirtualConeLight(Vec3(0.0f, 0.0f, -1.0f));
+    cone->light.setAngle(0.6f);
+    virtualLights.push_back(cone);
+
+    const long long tests = (long long)primitiveCount * rayCount;
+    float virtualSum = 0.0f, taggedSum = 0.0f;
+    double virtualNs = timeRuns(runs, tests, [&] { return traceVirtual(rays, virtualObjects, virtualLights); }, virtualSum);
+    double taggedNs = timeRuns(runs, tests, [&] { return traceTagged(rays, scene.getSurfaces(), scene.getLights()); }, taggedSum);
+
+    cout << primitiveCount << " primitives, " << rayCount << " rays (best of " << runs << ")" << endl;
+    cout << "  virtual + dynamic_cast: " << virtualNs << " ns/test (checksum " << virtualSum << ")" << endl;
+    cout << "  kind tag:               " << taggedNs << " ns/test (checksum " << taggedSum << ")" << endl;
+    cout << "  speedup:                " << virtualNs / taggedNs << "x" << endl;
+
+    for (VirtualPrimitive* obj : virtualObjects) delete obj;
+    for (VirtualLight* light : virtualLights) delete light;
+    for (Primitive* obj : objects) delete obj;
+    for (Illumination* light : lights) delete light;
+    return 0;
+}
@@ -1,6 +1,14 @@
 #include "HitResult.h"
+#include "Surface.h"
+#include "RayCast.h"
 
-// Constructor: initialize with intersection point and hit primitive
-HitResult::HitResult(glm::vec3 point, Primitive* primitive) : pt(point), prim(primitive) {}
+// Constructor: no primitive yet, search interval ends at tmax
+HitResult::HitResult(float tmax) : t(tmax), prim(nullptr), pt(0.0f), normal(0.0f) {}
+
+// Evaluate the ray at t and ask the surface for its normal there
+void HitResult::resolve(const RayCast& ray) {
+    pt = ray.pointAt(t);
+    normal = prim->get_normal(pt);
+}
 
 HitResult::~HitResult() {}
@@ -1,29 +1,39 @@
 #pragma once
 
-#define GLM_ENABLE_EXPERIMENTAL
-
 #include <glm/glm.hpp>
-#include <glm/gtx/norm.hpp>
+#include <limits>
 
-#include <string.h>
-#include <iostream>
-#include <vector>
-#include "Primitive.h"
+struct Surface;
+class RayCast;
 
-// Hit result: stores intersection point and the primitive that was hit
+// Hit record for t-bounded ray queries.
+// While a query runs, t holds the current upper bound of the search interval:
+// every accepted hit shrinks it, so later candidates are rejected early.
+// Point and normal are only computed once, for the final hit (see resolve).
 class HitResult
 {
     protected:
-        glm::vec3 pt;      // Intersection point
-        Primitive* prim;   // Pointer to hit primitive
+        float t;            // Ray parameter of the hit (or current tmax)
+        const Surface* prim;  // Hit surface (nullptr if nothing was hit)
+        glm::vec3 pt;       // Intersection point (valid after resolve)
+        glm::vec3 normal;   // Surface normal at pt (valid after resolve)
 
     public:
-        // Constructor: create hit result with point and primitive
-        HitResult(glm::vec3 point, Primitive* primitive);
-        
+        // Constructor: empty record searching up to tmax
+        explicit HitResult(float tmax = std::numeric_limits<float>::infinity());
+
+        // Record a closer hit: t becomes the new tmax
+        void record(float hitT, const Surface* surface) { t = hitT; prim = surface; }
+
+        // Compute point and surface normal of the recorded hit
+        void resolve(const RayCast& ray);
+
         // Getters
-        Primitive* get_object() { return prim; }
-        glm::vec3 get_point() { return pt; }
+        bool is_hit() const { return prim != nullptr; }
+        float get_t() const { return t; }
+        const Surface* get_object() const { return prim; }
+        const glm::vec3& get_point() const { return pt; }
+        const glm::vec3& get_normal() const { return normal; }
 
         ~HitResult();
 };
@@ -3,16 +3,25 @@
 using Vec3 = glm::vec3;
 #include <limits> 
 
-// Base class for all light sources in the scene
+// Concrete light types (the set is closed: every Illumination is one of these)
+enum LightKind : int {
+    GLOBAL_LIGHT,    // ambient
+    PARALLEL_LIGHT,  // directional
+    CONE_LIGHT       // spotlight
+};
+
+// Base class for all light sources in the scene.
+// Type queries read the kind tag, so callers can static_cast without RTTI.
 class Illumination {
 protected:
+    LightKind kind;            // Concrete type
     glm::vec3 lightDirection;  // Direction vector (normalized)
     glm::vec3 lightColor;       // RGB color/intensity
     bool colorConfigured = false;  // Whether color has been set
 
 public:
-    // Constructor: initialize with direction (auto-normalized)
-    Illumination(const Vec3& direction) : lightDirection(glm::normalize(direction)) {};
+    // Constructor: initialize with concrete type and direction (auto-normalized)
+    Illumination(LightKind k, const Vec3& direction) : kind(k), lightDirection(glm::normalize(direction)) {};
 
     virtual ~Illumination() = default;
 
@@ -25,9 +34,10 @@ public:
     // Check if color has been configured
     bool isColorSet() const { return colorConfigured; }
 
-    // Type queries (must be implemented by derived classes)
-    virtual bool isConeType() = 0;    // Is this a cone/spotlight?
-    virtual bool isGlobalType() = 0;   // Is this ambient/global light?
+    // Type queries
+    LightKind getKind() const { return kind; }
+    bool isConeType() const { return kind == CONE_LIGHT; }      // Is this a cone/spotlight?
+    bool isGlobalType() const { return kind == GLOBAL_LIGHT; }  // Is this ambient/global light?
 
     // Getters
     const Vec3& getDirection() const { return lightDirection; }
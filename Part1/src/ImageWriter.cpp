@@ -0,0 +1,273 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "PngEncoder.h"
+
+// Write a header (may be empty) followed by bytes
+static bool writeFile(const std::string& path, const std::string& header, const void* bytes, size_t length) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(header.data(), (std::streamsize)header.size());
+    file.write(static_cast<const char*>(bytes), (std::streamsize)length);
+    return (bool)file;
+}
+
+// Write pixelCount pixels converted by expand(first, count, out) in chunks
+// of CHUNK_PIXELS, so no full-size copy of the image is made
+template <typename T, typename Expand>
+static bool writeExpanded(const std::string& path, size_t pixelCount, Expand expand) {
+    const size_t CHUNK_PIXELS = 16384;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    std::vector<T> chunk(4 * CHUNK_PIXELS);
+    for (size_t first = 0; first < pixelCount; first += CHUNK_PIXELS) {
+        const size_t count = std::min(CHUNK_PIXELS, pixelCount - first);
+        expand(first, count, chunk.data());
+        file.write(reinterpret_cast<const char*>(chunk.data()), (std::streamsize)(4 * count * sizeof(T)));
+    }
+    return (bool)file;
+}
+
+// ============================================================================
+// BACKENDS
+// ============================================================================
+
+class PngImageStream final : public ImageStream {
+public:
+    PngImageStream(ThreadPool& pool, int level, int width) : stream(pool, level), width(width) {}
+
+    bool open(const std::string& path, int height) { return stream.open(path, width, height, 3); }
+
+    bool writeRows(const ImageBuffer& band) override {
+        return band.width == width && stream.writeRows(band.rgb.data(), band.height);
+    }
+
+    bool finish() override { return stream.finish(); }
+
+private:
+    PngStream stream;
+    const int width;
+};
+
+class PngImageWriter final : public ImageWriter {
+public:
+    PngImageWriter(ThreadPool& pool, int level) : pool(pool), encoder(pool, level) {}
+
+    const char* getExtension() const override { return "png"; }
+
+    bool write(const std::string& path, const ImageBuffer& image) const override {
+        return encoder.write(path, image.rgb.data(), image.width, image.height, 3);
+    }
+
+    bool canStream() const override { return true; }
+
+    std::unique_ptr<ImageStream> openStream(const std::string& path, int width, int height) const override {
+        std::unique_ptr<PngImageStream> stream(new PngImageStream(pool, encoder.getLevel(), width));
+        if (!stream->open(path, height)) return nullptr;
+        return std::move(stream);
+    }
+
+private:
+    ThreadPool& pool;
+    PngEncoder encoder;
+};
+
+static std::string ppmHeader(int width, int height) {
+    return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+// Header, then the rows as they arrive
+class PpmImageStream final : public ImageStream {
+public:
+    PpmImageStream(int width, int height) : width(width), rowsLeft(height) {}
+
+    bool open(const std::string& path, int height) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        const std::string header = ppmHeader(width, height);
+        file.write(header.data(), (std::streamsize)header.size());
+        return (bool)file;
+    }
+
+    bool writeRows(const ImageBuffer& band) override {
+        if (band.width != width || band.height > rowsLeft) return false;
+        file.write(reinterpret_cast<const char*>(band.rgb.data()), (std::streamsize)(3 * (size_t)width * band.height));
+        rowsLeft -= band.height;
+        return (bool)file;
+    }
+
+    bool finish() override {
+        file.close();
+        return rowsLeft == 0 && !file.fail();
+    }
+
+private:
+    std::ofstream file;
+    const int width;
+    int rowsLeft;
+};
+
+class PpmImageWriter final : public ImageWriter {
+public:
+    const char* getExtension() const override { return "ppm"; }
+
+    bool write(const std::string& path, const ImageBuffer& image) const override {
+        return writeFile(path, ppmHeader(image.width, image.height), image.rgb.data(), image.rgb.size());
+    }
+
+    bool canStream() const override { return true; }
+
+    std::unique_ptr<ImageStream> openStream(const std::string& path, int width, int height) const override {
+        std::unique_ptr<PpmImageStream> stream(new PpmImageStream(width, height));
+        if (!stream->open(path, height)) return nullptr;
+        return std::move(stream);
+    }
+};
+
+// QOI (https://qoiformat.org): every pixel becomes a run, an index into 64
+// recently seen colors, a small difference to the previous pixel, or a literal
+class QoiImageWriter final : public ImageWriter {
+public:
+    const char* getExtension() const override { return "qoi"; }
+
+    bool write(const std::string& path, const ImageBuffer& image) const override {
+        std::vector<unsigned char> out;
+        encode(image, out);
+        return writeFile(path, std::string(), out.data(), out.size());
+    }
+
+private:
+    enum : unsigned char {
+        OP_INDEX = 0x00, OP_DIFF = 0x40, OP_LUMA = 0x80, OP_RUN = 0xc0, OP_RGB = 0xfe
+    };
+
+    static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(value >> shift));
+    }
+
+    static void encode(const ImageBuffer& image, std::vector<unsigned char>& out) {
+        const size_t pixelCount = (size_t)image.width * image.height;
+        out.reserve(14 + pixelCount * 4 + 8);  // worst case: every pixel is OP_RGB
+        out.insert(out.end(), {'q', 'o', 'i', 'f'});
+        putBigEndian(out, (uint32_t)image.width);
+        putBigEndian(out, (uint32_t)image.height);
+        out.push_back(3);  // RGB
+        out.push_back(0);  // sRGB with linear alpha
+
+        // The index starts as transparent black, as in the decoder, so its
+        // alpha must be kept and compared even though every pixel is opaque
+        struct Color { unsigned char r, g, b, a; };
+        Color seen[64] = {};
+        Color prev = {0, 0, 0, 255};
+        int run = 0;
+        const unsigned char* rgb = image.rgb.data();
+        for (size_t i = 0; i < pixelCount; ++i) {
+            Color px = {rgb[3 * i], rgb[3 * i + 1], rgb[3 * i + 2], 255};
+            if (px.r == prev.r && px.g == prev.g && px.b == prev.b) {
+                if (++run == 62 || i + 1 == pixelCount) {
+                    out.push_back((unsigned char)(OP_RUN | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                out.push_back((unsigned char)(OP_RUN | (run - 1)));
+                run = 0;
+            }
+
+            const int slot = (px.r * 3 + px.g * 5 + px.b * 7 + 255 * 11) % 64;  // alpha is always 255
+            if (seen[slot].r == px.r && seen[slot].g == px.g && seen[slot].b == px.b && seen[slot].a == px.a) {
+                out.push_back((unsigned char)(OP_INDEX | slot));
+            } else {
+                seen[slot] = px;
+                const signed char dr = (signed char)(px.r - prev.r);
+                const signed char dg = (signed char)(px.g - prev.g);
+                const signed char db = (signed char)(px.b - prev.b);
+                const int drg = dr - dg, dbg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out.push_back((unsigned char)(OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    out.push_back((unsigned char)(OP_LUMA | (dg + 32)));
+                    out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+                } else {
+                    out.insert(out.end(), {OP_RGB, px.r, px.g, px.b});
+                }
+            }
+            prev = px;
+        }
+        out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});  // end marker
+    }
+};
+
+class RgbaImageWriter final : public ImageWriter {
+public:
+    const char* getExtension() const override { return "rgba"; }
+
+    bool write(const std::string& path, const ImageBuffer& image) const override {
+        const unsigned char* rgb = image.rgb.data();
+        return writeExpanded<unsigned char>(path, (size_t)image.width * image.height,
+                                            [rgb](size_t first, size_t count, unsigned char* out) {
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(out + 4 * i, rgb + 3 * (first + i), 3);
+                out[4 * i + 3] = 255;
+            }
+        });
+    }
+};
+
+class FloatImageWriter final : public ImageWriter {
+public:
+    const char* getExtension() const override { return "f32"; }
+
+    bool needsRadiance() const override { return true; }
+
+    bool write(const std::string& path, const ImageBuffer& image) const override {
+        const size_t pixelCount = (size_t)image.width * image.height;
+        if (image.radiance.size() != 3 * pixelCount) return false;
+        const float* radiance = image.radiance.data();
+        return writeExpanded<float>(path, pixelCount, [radiance](size_t first, size_t count, float* out) {
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(out + 4 * i, radiance + 3 * (first + i), 3 * sizeof(float));
+                out[4 * i + 3] = 1.0f;
+            }
+        });
+    }
+};
+
+// ============================================================================
+// FACTORY
+// ============================================================================
+
+std::unique_ptr<ImageWriter> ImageWriter::create(const std::string& format, ThreadPool& pool, int pngLevel) {
+    std::string name = (!format.empty() && format[0] == '.') ? format.substr(1) : format;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+    if (name == "png") return std::unique_ptr<ImageWriter>(new PngImageWriter(pool, pngLevel));
+    if (name == "ppm") return std::unique_ptr<ImageWriter>(new PpmImageWriter());
+    if (name == "qoi") return std::unique_ptr<ImageWriter>(new QoiImageWriter());
+    if (name == "rgba") return std::unique_ptr<ImageWriter>(new RgbaImageWriter());
+    if (name == "f32") return std::unique_ptr<ImageWriter>(new FloatImageWriter());
+    return nullptr;
+}
+
+std::string ImageWriter::extensionOf(const std::string& path) {
+    size_t lastSlash = path.find_last_of("/\\");
+    size_t lastDot = path.find_last_of('.');
+    if (lastDot == std::string::npos || (lastSlash != std::string::npos && lastDot < lastSlash)) return "";
+    return path.substr(lastDot + 1);
+}
+
+std::string ImageWriter::outputPathFor(const std::string& scenePath, const std::string& extension) {
+    size_t lastSlash = scenePath.find_last_of("/\\");
+    std::string filename = (lastSlash == std::string::npos) ? scenePath : scenePath.substr(lastSlash + 1);
+    size_t lastDot = filename.find_last_of('.');
+    if (lastDot != std::string::npos) {
+        filename = filename.substr(0, lastDot);
+    }
+    return "results/" + filename + "." + extension;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Rendered image: clamped 8-bit RGB for every pixel, plus the unclamped float
+// RGB colors when a writer needs them (see ImageWriter::needsRadiance).
+// Rows run top to bottom.
+struct ImageBuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb;   // 3 bytes per pixel
+    std::vector<float> radiance;      // 3 floats per pixel, or empty
+
+    ImageBuffer(int width, int height, bool keepRadiance)
+        : width(width), height(height), rgb(3 * (size_t)width * height, 0),
+          radiance(keepRadiance ? 3 * (size_t)width * height : 0, 0.0f) {}
+};
+
+// Output file written a band of rows at a time (see ImageWriter::openStream)
+class ImageStream {
+public:
+    virtual ~ImageStream() = default;
+
+    // Append the next band: an image of the full width whose rows follow the
+    // rows written so far. Returns false on I/O errors or rows past the end.
+    virtual bool writeRows(const ImageBuffer& band) = 0;
+
+    // Complete and close the file after the last row; false on I/O errors or
+    // if rows are missing
+    virtual bool finish() = 0;
+};
+
+// Output format backend. Formats:
+//   png   PNG, deflated in parallel strips (PngEncoder); streams (PngStream)
+//   ppm   binary PPM (P6): header + raw 8-bit RGB, no compression; streams
+//   qoi   QOI: fast lossless run/index/difference coding
+//   rgba  headerless 8-bit RGBA (alpha 255)
+//   f32   headerless float32 RGBA in native byte order, unclamped (alpha 1)
+class ImageWriter {
+public:
+    virtual ~ImageWriter() = default;
+
+    // File extension without the dot, e.g. "png"
+    virtual const char* getExtension() const = 0;
+
+    // Whether write reads ImageBuffer::radiance
+    virtual bool needsRadiance() const { return false; }
+
+    // Write image to path; returns false on I/O errors
+    virtual bool write(const std::string& path, const ImageBuffer& image) const = 0;
+
+    // Whether openStream is supported: the file can be written band by band
+    // without the whole image in memory
+    virtual bool canStream() const { return false; }
+
+    // Create path for a width x height image and write its header; nullptr on
+    // I/O errors or if the format cannot stream
+    virtual std::unique_ptr<ImageStream> openStream(const std::string& path, int width, int height) const {
+        return nullptr;
+    }
+
+    // Writer for a format name or file extension (e.g. "qoi" or ".qoi"); nullptr
+    // if unknown. PNG output is encoded on pool with compression pngLevel.
+    static std::unique_ptr<ImageWriter> create(const std::string& format, ThreadPool& pool, int pngLevel);
+
+    // Extension of path without the dot ("" if it has none)
+    static std::string extensionOf(const std::string& path);
+
+    // Default output file for a scene file: results/<scene name>.<extension>
+    static std::string outputPathFor(const std::string& scenePath, const std::string& extension);
+};
@@ -0,0 +1,156 @@
+#include "LightGrid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// Build parameters
+static const float MAX_CELLS_PER_SPHERE = 4.0f;  // sparse scenes get larger cells
+static const int MAX_CELLS_PER_AXIS = 1024;
+static const int MAX_ENTRIES_PER_SPHERE = 8;     // more copies than this and the grid is not built
+
+// Constructor: project the spheres, size the cells to them, count how often
+// each would be copied (it goes into every cell its padded disc overlaps),
+// then bin them unless that is too many copies
+LightGrid::LightGrid(const Surface* surfaces, int count, const Vec3& direction)
+    : surfaces(surfaces), direction(direction) {
+    const Vec3 helper = (std::fabs(direction.x) < 0.9f) ? Vec3(1.0f, 0.0f, 0.0f) : Vec3(0.0f, 1.0f, 0.0f);
+    axisU = glm::normalize(glm::cross(direction, helper));
+    axisV = glm::cross(direction, axisU);
+
+    std::vector<int> sphereIndices;
+    Vec3 lo(std::numeric_limits<float>::infinity()), hi(-std::numeric_limits<float>::infinity());
+    for (int i = 0; i < count; ++i) {
+        const Surface& surface = surfaces[i];
+        if (surface.is_plane()) {
+            planes.push_back((uint32_t)i);
+            continue;
+        }
+        sphereIndices.push_back(i);
+        lo = glm::min(lo, surface.point - Vec3(surface.radius));
+        hi = glm::max(hi, surface.point + Vec3(surface.radius));
+    }
+    cellStart.push_back(0);
+    usable = true;
+    if (sphereIndices.empty()) return;
+    const int sphereCount = (int)sphereIndices.size();
+
+    // The sphere kernel computes distSq = |c - o|^2 - proj^2, which is off by
+    // up to about 8 ulps of |c - o|^2, so a ray passing just outside a disc can
+    // be reported as a hit. With |c - o| at most the spheres' diagonal, padding
+    // a disc to sqrt(r^2 + slack) covers that; projecting a point onto the
+    // grid adds a few ulps of its distance from the world origin.
+    const float diagonal = glm::length(hi - lo);
+    const float distanceFromOrigin = std::max(glm::length(lo), glm::length(hi));
+    const float slack = 8.0f * FLT_EPSILON * diagonal * diagonal;
+    const float projectionSlack = 4.0f * FLT_EPSILON * distanceFromOrigin;
+    auto paddedRadius = [&](float radius) { return std::sqrt(radius * radius + slack) + projectionSlack; };
+    // t is a square root of distSq's difference from r^2, so it inherits the square root of its error
+    reachMargin = 2.0f * std::sqrt(8.0f * FLT_EPSILON) * diagonal + projectionSlack;
+
+    float maxU = -std::numeric_limits<float>::infinity(), maxV = maxU;
+    minU = minV = std::numeric_limits<float>::infinity();
+    double diameterSum = 0.0;
+    for (int index : sphereIndices) {
+        const Surface& sphere = surfaces[index];
+        const float u = glm::dot(sphere.point, axisU), v = glm::dot(sphere.point, axisV);
+        const float extent = paddedRadius(sphere.radius);
+        minU = std::min(minU, u - extent);
+        maxU = std::max(maxU, u + extent);
+        minV = std::min(minV, v - extent);
+        maxV = std::max(maxV, v + extent);
+        diameterSum += 2.0 * extent;
+    }
+
+    // Cells one mean disc across, so a typical sphere lands in 1 to 4 of them;
+    // larger where that would give many empty cells
+    const float width = maxU - minU, height = maxV - minV;
+    float cellSize = (float)(diameterSum / sphereCount);
+    cellSize = std::max(cellSize, std::sqrt(width * height / (MAX_CELLS_PER_SPHERE * sphereCount)));
+    cellSize = std::max(cellSize, std::max(width, height) / (float)MAX_CELLS_PER_AXIS);
+    if (!(cellSize > 0.0f)) cellSize = 1.0f;
+    inverseCellSize = 1.0f / cellSize;
+    cellsU = std::min(MAX_CELLS_PER_AXIS, std::max(1, (int)std::ceil(width * inverseCellSize)));
+    cellsV = std::min(MAX_CELLS_PER_AXIS, std::max(1, (int)std::ceil(height * inverseCellSize)));
+
+    // Cells covered by a sphere's padded disc, clamped to the grid
+    struct Cover { int u0, u1, v0, v1; };
+    auto cellOf = [&](float offset, int cells) {
+        return std::min(cells - 1, std::max(0, (int)std::floor(offset * inverseCellSize)));
+    };
+    auto coverOf = [&](const Surface& sphere) {
+        const float u = glm::dot(sphere.point, axisU) - minU, v = glm::dot(sphere.point, axisV) - minV;
+        const float extent = paddedRadius(sphere.radius);
+        return Cover{cellOf(u - extent, cellsU), cellOf(u + extent, cellsU),
+                     cellOf(v - extent, cellsV), cellOf(v + extent, cellsV)};
+    };
+
+    // Count the copies per cell first: too many and the grid would cost more
+    // memory and build time than it saves, so the light keeps using the BVH
+    std::vector<int> counts((size_t)cellsU * cellsV + 1, 0);
+    int64_t entries = 0;
+    for (int index : sphereIndices) {
+        const Cover cover = coverOf(surfaces[index]);
+        entries += (int64_t)(cover.u1 - cover.u0 + 1) * (cover.v1 - cover.v0 + 1);
+        if (entries > (int64_t)MAX_ENTRIES_PER_SPHERE * sphereCount) {
+            usable = false;
+            cellsU = cellsV = 0;
+            planes.clear();
+            return;
+        }
+        for (int cv = cover.v0; cv <= cover.v1; ++cv) {
+            for (int cu = cover.u0; cu <= cover.u1; ++cu) ++counts[(size_t)cv * cellsU + cu + 1];
+        }
+    }
+    cellStart.resize(counts.size());
+    for (size_t cell = 1; cell < counts.size(); ++cell) cellStart[cell] = cellStart[cell - 1] + counts[cell];
+
+    // Bin (reach, surface index) entries into their cells
+    struct Entry { float reach; int index; };
+    std::vector<Entry> binned((size_t)entries);
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int index : sphereIndices) {
+        const Surface& sphere = surfaces[index];
+        const Cover cover = coverOf(sphere);
+        const float sphereReach = glm::dot(sphere.point, direction) + sphere.radius;
+        for (int cv = cover.v0; cv <= cover.v1; ++cv) {
+            for (int cu = cover.u0; cu <= cover.u1; ++cu) {
+                binned[fill[(size_t)cv * cellsU + cu]++] = {sphereReach, index};
+            }
+        }
+    }
+
+    // Lay the cells out one after another, each sorted by reach (farthest toward the light first)
+    reach.reserve(binned.size());
+    for (size_t cell = 0; cell + 1 < cellStart.size(); ++cell) {
+        std::sort(binned.begin() + cellStart[cell], binned.begin() + cellStart[cell + 1],
+                  [](const Entry& a, const Entry& b) { return a.reach > b.reach; });
+    }
+    for (const Entry& entry : binned) {
+        spheres.add(surfaces[entry.index].point, surfaces[entry.index].radius);
+        reach.push_back(entry.reach);
+    }
+}
+
+// One cell, cut down to the spheres that reach past the origin toward the
+// light (tmin >= 0 puts every hit in front of the origin)
+bool LightGrid::isOccluded(const RayCast& ray, float tmin, float tmax) const {
+    for (uint32_t index : planes) {
+        if (surfaces[index].occludes(ray, tmin, tmax)) return true;
+    }
+    if (cellsU == 0) return false;
+
+    const Vec3& origin = ray.getOrigin();
+    const float u = (glm::dot(origin, axisU) - minU) * inverseCellSize;
+    const float v = (glm::dot(origin, axisV) - minV) * inverseCellSize;
+    if (!(u >= 0.0f && u < (float)cellsU && v >= 0.0f && v < (float)cellsV)) return false;
+    const int cell = (int)v * cellsU + (int)u;
+
+    const float depth = glm::dot(origin, direction) - reachMargin;
+    const int first = cellStart[cell];
+    const int last = (int)(std::upper_bound(reach.begin() + first, reach.begin() + cellStart[cell + 1], depth,
+                                            std::greater<float>()) - reach.begin());
+    return last > first && spheres.anyHit(origin, ray.getDirection(), first, last - first, tmin, tmax);
+}
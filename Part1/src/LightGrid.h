@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "Surface.h"
+#include "RayCast.h"
+#include "SphereBlock.h"
+
+using Vec3 = glm::vec3;
+
+// Shadow index for one parallel light. Every shadow ray toward the light has
+// the same direction, so a sphere can only block the rays whose origins
+// project into its disc on a plane perpendicular to that direction. The
+// spheres are projected onto that plane and binned into a uniform 2D grid
+// whose cells are about one projected sphere across; a query projects its
+// origin, picks one cell and tests only the spheres in it (in a SphereBlock
+// of their own, so with the same kernel as the BVH).
+// In a cell, spheres are sorted by how far toward the light they reach, and
+// spheres that end behind the ray origin are not tested at all.
+// This is exact, not a shadow map: discs are padded by a few float ulps so the
+// answer is that of BVH::isOccluded (for origins within the spheres' bounds).
+// Planes are unbounded and are tested linearly, as in the BVH.
+// Scenes where the discs would be copied into too many cells (e.g. a few
+// spheres spanning the whole grid) get no grid: isUsable() is false.
+class LightGrid {
+public:
+    // Build over the surfaces[0, count) for the light direction (normalized,
+    // pointing toward the light); the surfaces must outlive the grid
+    LightGrid(const Surface* surfaces, int count, const Vec3& direction);
+
+    // Queries point into the grid's sphere block, so a grid is not copied
+    LightGrid(const LightGrid&) = delete;
+    LightGrid& operator=(const LightGrid&) = delete;
+
+    // Whether the grid was built (otherwise use the BVH)
+    bool isUsable() const { return usable; }
+
+    // Any-hit shadow query inside (tmin, tmax), tmin >= 0; the ray must have
+    // the light's direction
+    bool isOccluded(const RayCast& ray, float tmin, float tmax) const;
+
+    int getCellCount() const { return cellsU * cellsV; }
+    int getEntryCount() const { return spheres.size(); }
+
+private:
+    const Surface* surfaces;
+    Vec3 direction;
+    Vec3 axisU, axisV;             // orthonormal basis of the projection plane
+    float minU = 0, minV = 0;      // grid origin on that plane
+    float inverseCellSize = 0;
+    int cellsU = 0, cellsV = 0;
+    float reachMargin = 0;         // absorbs rounding in the behind-the-origin cut
+    bool usable = false;
+
+    std::vector<int> cellStart;    // lanes of cell c: [cellStart[c], cellStart[c + 1])
+    std::vector<float> reach;      // per lane: center . direction + radius (descending in a cell)
+    SphereBlock spheres;           // the cells' spheres, cell after cell
+    std::vector<uint32_t> planes;  // surface indices
+};
@@ -1,4 +1,4 @@
 #include "ParallelLight.h"
 
 // Constructor: initialize with direction vector
-ParallelLight::ParallelLight(const Vec3 &dir): Illumination(dir) {}
+ParallelLight::ParallelLight(const Vec3 &dir): Illumination(PARALLEL_LIGHT, dir) {}
@@ -1,10 +1,10 @@
+#pragma once
+
 #include "Primitive.h"
 #include <string>
-#include "RayCast.h"
-#include "HitResult.h"
 
 // Plane primitive: defined by normal vector and distance from origin
-class Plane : public Primitive
+class Plane final : public Primitive
 {
     private:
         Vec3 n;       // Plane normal vector
@@ -14,14 +14,11 @@ class Plane : public Primitive
         // Constructor: create plane with normal, distance, and material type
         Plane(Vec3 normal, float d, MaterialType mat);
 
-        // Find intersection point with ray (returns infinity if no intersection)
-        Vec3 get_intersection(RayCast ray);
+        // A point on the plane (throws if the normal is the zero vector)
+        Vec3 point_on_plane() const;
 
-        // Is a plane
-        bool is_plane() const override { return true; }
-        
-        // Get surface normal (always -n for consistent orientation)
-        Vec3 get_normal(const Vec3& p) const override { return glm::normalize(-n); }
+        // Plane normal as given in the scene (not normalized)
+        const Vec3& get_plane_normal() const { return n; }
 
         ~Plane();
 };
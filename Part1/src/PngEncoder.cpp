@@ -0,0 +1,670 @@
+#include "PngEncoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// Filtered bytes per strip (rows are never split, so wide rows make larger strips)
+static const size_t STRIP_BYTES = 128 * 1024;
+
+// ============================================================================
+// CHECKSUMS
+// ============================================================================
+
+static const uint32_t ADLER_BASE = 65521;
+
+static uint32_t adler32(const unsigned char* data, size_t length) {
+    uint32_t a = 1, b = 0;
+    while (length > 0) {
+        size_t n = std::min<size_t>(length, 5552);  // largest run without overflow
+        length -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of A followed by B, from adler(A), adler(B) and the length of B
+static uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, uint64_t lengthB) {
+    uint32_t rem = (uint32_t)(lengthB % ADLER_BASE);
+    uint32_t sum1 = adlerA & 0xffff;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % ADLER_BASE);
+    sum1 += (adlerB & 0xffff) + ADLER_BASE - 1;
+    sum2 += (adlerA >> 16) + (adlerB >> 16) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= 2 * ADLER_BASE) sum2 -= 2 * ADLER_BASE;
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return (sum2 << 16) | sum1;
+}
+
+// CRC-32 (PNG chunks), continued from crc (start with 0)
+static uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length) {
+    static const struct CrcTable {
+        uint32_t entries[256];
+        CrcTable() {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ============================================================================
+// FILTERING
+// ============================================================================
+
+static unsigned char paeth(int a, int b, int c) {
+    int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return (unsigned char)a;
+    if (pb <= pc) return (unsigned char)b;
+    return (unsigned char)c;
+}
+
+static long absoluteSum(const unsigned char* residuals, size_t count) {
+    long sum = 0;
+    for (size_t i = 0; i < count; ++i) sum += std::abs((int)(signed char)residuals[i]);
+    return sum;
+}
+
+// Filter one row into out[0, rowBytes] (filter type byte first). prior is the
+// row above (all zeros for the first row). With choose, the filter with the
+// smallest sum of absolute residuals is used (the usual heuristic), else None.
+// scratch holds 4 * rowBytes bytes.
+static void filterRow(const unsigned char* row, const unsigned char* prior, size_t rowBytes, size_t bpp,
+                      bool choose, unsigned char* scratch, unsigned char* out) {
+    if (!choose) {
+        out[0] = 0;
+        std::memcpy(out + 1, row, rowBytes);
+        return;
+    }
+
+    unsigned char* sub = scratch;
+    unsigned char* up = scratch + rowBytes;
+    unsigned char* average = scratch + 2 * rowBytes;
+    unsigned char* paethRow = scratch + 3 * rowBytes;
+    const size_t lead = std::min(bpp, rowBytes);  // bytes without a left neighbour
+    for (size_t i = 0; i < lead; ++i) {
+        sub[i] = row[i];
+        up[i] = (unsigned char)(row[i] - prior[i]);
+        average[i] = (unsigned char)(row[i] - (prior[i] >> 1));
+        paethRow[i] = (unsigned char)(row[i] - prior[i]);
+    }
+    for (size_t i = lead; i < rowBytes; ++i) {
+        sub[i] = (unsigned char)(row[i] - row[i - bpp]);
+        up[i] = (unsigned char)(row[i] - prior[i]);
+        average[i] = (unsigned char)(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+        paethRow[i] = (unsigned char)(row[i] - paeth(row[i - bpp], prior[i], prior[i - bpp]));
+    }
+
+    const unsigned char* candidates[5] = {row, sub, up, average, paethRow};
+    int best = 0;
+    long bestCost = absoluteSum(row, rowBytes);
+    for (int type = 1; type < 5; ++type) {
+        long cost = absoluteSum(candidates[type], rowBytes);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = type;
+        }
+    }
+    out[0] = (unsigned char)best;
+    std::memcpy(out + 1, candidates[best], rowBytes);
+}
+
+// ============================================================================
+// DEFLATE (fixed Huffman codes)
+// ============================================================================
+
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const int WINDOW_SIZE = 32768;
+static const size_t MAX_DISTANCE = WINDOW_SIZE - MAX_MATCH - MIN_MATCH - 1;
+static const int HASH_BITS = 15;
+
+static const unsigned short LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                               35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                                 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                                                 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Match search effort per level (1..9), as in zlib's configuration table
+struct LevelParams {
+    int goodLength;   // search a quarter of the chain after a match this long
+    int maxLazy;      // lazy levels: no lazy search after a match this long;
+                      // greedy levels: longest match whose positions are all hashed
+    int niceLength;   // stop searching at a match this long
+    int maxChain;     // candidates visited per position
+};
+
+static const int FIRST_LAZY_LEVEL = 4;
+static const size_t TOO_FAR = 4096;  // length-3 matches further back cost more than literals
+
+static const LevelParams LEVEL_PARAMS[PngEncoder::MAX_LEVEL + 1] = {
+    {0, 0, 0, 0},
+    {4, 4, 8, 4}, {4, 5, 16, 8}, {4, 6, 32, 32},
+    {4, 4, 16, 16}, {8, 16, 32, 32}, {8, 16, 128, 128},
+    {8, 32, 128, 256}, {32, 128, 258, 1024}, {32, 258, 258, 4096},
+};
+
+static uint32_t reverseBits(uint32_t code, int bits) {
+    uint32_t result = 0;
+    for (int i = 0; i < bits; ++i, code >>= 1) result = (result << 1) | (code & 1);
+    return result;
+}
+
+// Fixed Huffman codes (bit-reversed, ready to write LSB first) and the
+// match length -> length symbol table
+struct FixedCodes {
+    unsigned short literalCode[288];
+    unsigned char literalBits[288];
+    unsigned short distanceCode[30];
+    unsigned char lengthIndex[MAX_MATCH + 1];
+
+    FixedCodes() {
+        for (int symbol = 0; symbol < 288; ++symbol) {
+            uint32_t code;
+            int bits;
+            if (symbol < 144)      { code = 0x30 + symbol;         bits = 8; }
+            else if (symbol < 256) { code = 0x190 + symbol - 144;  bits = 9; }
+            else if (symbol < 280) { code = symbol - 256;          bits = 7; }
+            else                   { code = 0xc0 + symbol - 280;   bits = 8; }
+            literalCode[symbol] = (unsigned short)reverseBits(code, bits);
+            literalBits[symbol] = (unsigned char)bits;
+        }
+        for (int i = 0; i < 30; ++i) distanceCode[i] = (unsigned short)reverseBits(i, 5);
+        for (int index = 0, length = MIN_MATCH; length <= MAX_MATCH; ++length) {
+            while (index < 28 && length >= LENGTH_BASE[index + 1]) ++index;
+            lengthIndex[length] = (unsigned char)index;
+        }
+    }
+};
+
+static const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+// Distance (1..32768) -> distance symbol
+static int distanceIndex(size_t distance) {
+    if (distance <= 4) return (int)distance - 1;
+    size_t d = distance - 1;
+    int top = 0;
+    while ((d >> (top + 1)) != 0) ++top;
+    return 2 * top + (int)((d >> (top - 1)) & 1);
+}
+
+// LSB-first bit writer appending to a byte vector
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void put(uint32_t value, int count) {
+        bits |= (uint64_t)value << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back((unsigned char)bits);
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    // Pad with zero bits to the next byte boundary
+    void alignToByte() {
+        if (bitCount > 0) put(0, 8 - bitCount);
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    uint64_t bits = 0;
+    int bitCount = 0;
+};
+
+// Store data[begin, end) in stored blocks; BFINAL is set on the last block if last
+static void storeStrip(const unsigned char* data, size_t begin, size_t end, bool last,
+                       std::vector<unsigned char>& out) {
+    for (size_t p = begin; p < end;) {
+        size_t n = std::min<size_t>(end - p, 65535);
+        out.push_back((last && p + n == end) ? 1 : 0);  // BFINAL, BTYPE = 00
+        out.push_back((unsigned char)n);
+        out.push_back((unsigned char)(n >> 8));
+        out.push_back((unsigned char)~n);
+        out.push_back((unsigned char)(~n >> 8));
+        out.insert(out.end(), data + p, data + p + n);
+        p += n;
+    }
+}
+
+// Number of equal leading bytes of a and b, at most limit (compares 8 bytes at a time)
+static int matchLength(const unsigned char* a, const unsigned char* b, int limit) {
+    int n = 0;
+    while (n + 8 <= limit) {
+        uint64_t x, y;
+        std::memcpy(&x, a + n, 8);
+        std::memcpy(&y, b + n, 8);
+        if (x != y) break;
+        n += 8;
+    }
+    while (n < limit && a[n] == b[n]) ++n;
+    return n;
+}
+
+// Hash chains over positions relative to the start of the window
+class MatchFinder {
+public:
+    MatchFinder(const unsigned char* data, size_t windowStart, const LevelParams& params)
+        : data(data), windowStart(windowStart), params(params),
+          head((size_t)1 << HASH_BITS, -1), prev(WINDOW_SIZE, -1) {}
+
+    static uint32_t hash(const unsigned char* p) {
+        return ((uint32_t)p[0] << 10 ^ (uint32_t)p[1] << 5 ^ p[2]) & ((1u << HASH_BITS) - 1);
+    }
+
+    // Make position p (with MIN_MATCH bytes after it) available to later matches
+    void insert(size_t p) {
+        int32_t relative = (int32_t)(p - windowStart);
+        uint32_t h = hash(data + p);
+        prev[relative & (WINDOW_SIZE - 1)] = head[h];
+        head[h] = relative;
+    }
+
+    // Longest earlier match for p that is longer than prevLength (and at least
+    // MIN_MATCH) and at most limit bytes; returns 0 if there is none
+    int longest(size_t p, int limit, int prevLength, size_t& distance) const {
+        int best = std::max(prevLength, MIN_MATCH - 1);
+        if (best >= limit) return 0;
+        int chain = (prevLength >= params.goodLength) ? params.maxChain >> 2 : params.maxChain;
+        const int nice = std::min(params.niceLength, limit);
+        int found = 0;
+
+        int32_t candidate = head[hash(data + p)];
+        while (candidate >= 0 && chain-- > 0) {
+            size_t c = windowStart + (size_t)candidate;
+            if (p - c > MAX_DISTANCE) break;
+            if (data[c + best] == data[p + best] && data[c] == data[p]) {
+                int length = matchLength(data + c, data + p, limit);
+                if (length > best) {
+                    best = found = length;
+                    distance = p - c;
+                    if (length >= nice) break;
+                }
+            }
+            int32_t next = prev[candidate & (WINDOW_SIZE - 1)];
+            if (next >= candidate) break;  // slot reused by a newer position
+            candidate = next;
+        }
+        return found;
+    }
+
+private:
+    const unsigned char* data;
+    size_t windowStart;
+    const LevelParams& params;
+    std::vector<int32_t> head;
+    std::vector<int32_t> prev;
+};
+
+// Deflate data[begin, end) as one fixed-Huffman block. data[windowStart, begin)
+// is history that matches may refer to. A non-final strip ends with a sync
+// flush, so the next strip starts on a byte boundary. Levels below
+// FIRST_LAZY_LEVEL take the first match found (zlib's deflate_fast), the
+// others defer a match by one byte when the next one is longer (deflate_slow).
+static void deflateStrip(const unsigned char* data, size_t windowStart, size_t begin, size_t end,
+                         int level, bool last, std::vector<unsigned char>& out) {
+    const FixedCodes& codes = fixedCodes();
+    const LevelParams& params = LEVEL_PARAMS[level];
+    const size_t outStart = out.size();
+    BitWriter writer(out);
+    writer.put(last ? 1 : 0, 1);  // BFINAL
+    writer.put(1, 2);             // BTYPE = 01, fixed Huffman
+
+    MatchFinder finder(data, windowStart, params);
+    for (size_t p = windowStart; p < begin && p + MIN_MATCH <= end; ++p) finder.insert(p);
+
+    auto literal = [&](unsigned char value) {
+        writer.put(codes.literalCode[value], codes.literalBits[value]);
+    };
+    auto match = [&](int length, size_t distance) {
+        int li = codes.lengthIndex[length];
+        int symbol = 257 + li;
+        writer.put(codes.literalCode[symbol], codes.literalBits[symbol]);
+        if (LENGTH_EXTRA[li]) writer.put(length - LENGTH_BASE[li], LENGTH_EXTRA[li]);
+        int di = distanceIndex(distance);
+        writer.put(codes.distanceCode[di], 5);
+        if (DISTANCE_EXTRA[di]) writer.put((uint32_t)(distance - DISTANCE_BASE[di]), DISTANCE_EXTRA[di]);
+    };
+    // Hash positions [from, to) that have MIN_MATCH bytes in the strip
+    auto insertRange = [&](size_t from, size_t to) {
+        for (size_t q = from; q < to && q + MIN_MATCH <= end; ++q) finder.insert(q);
+    };
+    auto limitAt = [&](size_t p) { return (int)std::min<size_t>(MAX_MATCH, end - p); };
+
+    if (level < FIRST_LAZY_LEVEL) {
+        size_t p = begin;
+        while (p < end) {
+            int length = 0;
+            size_t distance = 0;
+            if (p + MIN_MATCH <= end) {
+                length = finder.longest(p, limitAt(p), 0, distance);
+                finder.insert(p);
+            }
+            if (length == 0) {
+                literal(data[p++]);
+                continue;
+            }
+            match(length, distance);
+            if (length <= params.maxLazy) insertRange(p + 1, p + length);
+            p += length;
+        }
+    } else {
+        // A match found at p - 1 waits until the search at p has been done
+        bool pending = false;
+        int prevLength = 0;
+        size_t prevDistance = 0;
+        size_t p = begin;
+        while (p < end) {
+            int length = 0;
+            size_t distance = 0;
+            if (p + MIN_MATCH <= end) {
+                if (prevLength < params.maxLazy) length = finder.longest(p, limitAt(p), prevLength, distance);
+                if (length == MIN_MATCH && distance > TOO_FAR) length = 0;
+                finder.insert(p);
+            }
+            if (pending && prevLength >= MIN_MATCH && length <= prevLength) {
+                match(prevLength, prevDistance);
+                size_t matchEnd = p - 1 + prevLength;
+                insertRange(p + 1, matchEnd);
+                p = matchEnd;
+                pending = false;
+                prevLength = 0;
+            } else {
+                if (pending) literal(data[p - 1]);
+                pending = true;
+                prevLength = length;
+                prevDistance = distance;
+                ++p;
+            }
+        }
+        if (pending) literal(data[p - 1]);
+    }
+    writer.put(codes.literalCode[256], codes.literalBits[256]);  // end of block
+
+    if (!last) {
+        // Sync flush: empty stored block
+        writer.put(0, 3);
+        writer.alignToByte();
+        const unsigned char emptyStored[4] = {0x00, 0x00, 0xff, 0xff};
+        out.insert(out.end(), emptyStored, emptyStored + 4);
+    } else {
+        writer.alignToByte();
+    }
+
+    // Incompressible strip: stored blocks are smaller
+    const size_t storedSize = (end - begin) + 5 * ((end - begin + 65534) / 65535);
+    if (out.size() - outStart > storedSize) {
+        out.resize(outStart);
+        storeStrip(data, begin, end, last, out);
+    }
+}
+
+// ============================================================================
+// PNG
+// ============================================================================
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+// Length, type, data, CRC (crc covers type and data; pass it if already known)
+static void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data,
+                     size_t length, uint32_t crc) {
+    putBigEndian(out, (uint32_t)length);
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + length);
+    putBigEndian(out, crc);
+}
+
+static uint32_t chunkCrc(const char* type, const unsigned char* data, size_t length) {
+    return crc32Update(crc32Update(0, reinterpret_cast<const unsigned char*>(type), 4), data, length);
+}
+
+// Signature and IHDR chunk
+static void putHeader(std::vector<unsigned char>& out, int width, int height, int channels) {
+    const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    out.insert(out.end(), signature, signature + 8);
+
+    const unsigned char colorTypes[5] = {0, 0, 4, 2, 6};
+    std::vector<unsigned char> header;
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header, (uint32_t)height);
+    header.push_back(8);                     // bit depth
+    header.push_back(colorTypes[channels]);
+    header.push_back(0);                     // deflate
+    header.push_back(0);                     // adaptive filtering
+    header.push_back(0);                     // no interlace
+    putChunk(out, "IHDR", header.data(), header.size(), chunkCrc("IHDR", header.data(), header.size()));
+}
+
+// Compress filtered bytes data[begin, end) as one strip of the zlib stream,
+// primed with up to MAX_DISTANCE bytes before begin; the first strip carries
+// the zlib header
+static void compressStrip(const unsigned char* data, size_t begin, size_t end, int level, bool first, bool last,
+                          std::vector<unsigned char>& out) {
+    if (first) {
+        // zlib header: deflate, 32K window, FLEVEL from the level (FCHECK makes it a multiple of 31)
+        const unsigned char flags[4] = {0x01, 0x5e, 0x9c, 0xda};
+        out.push_back(0x78);
+        out.push_back(flags[level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3]);
+    }
+    if (level == 0) {
+        storeStrip(data, begin, end, last, out);
+    } else {
+        const size_t windowStart = begin - std::min(begin, MAX_DISTANCE);
+        deflateStrip(data, windowStart, begin, end, level, last, out);
+    }
+}
+
+static int clampLevel(int level) {
+    return level < PngEncoder::MIN_LEVEL ? PngEncoder::MIN_LEVEL : level > PngEncoder::MAX_LEVEL ? PngEncoder::MAX_LEVEL : level;
+}
+
+// Constructor: clamp the level
+PngEncoder::PngEncoder(ThreadPool& pool, int level) : pool(pool), level(clampLevel(level)) {}
+
+std::vector<unsigned char> PngEncoder::encode(const unsigned char* pixels, int width, int height,
+                                              int channels) const {
+    std::vector<unsigned char> png;
+    if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4) return png;
+
+    const size_t rowBytes = (size_t)width * channels;
+    const size_t filteredRow = rowBytes + 1;
+    const int rowsPerStrip = (int)std::max<size_t>(1, STRIP_BYTES / filteredRow);
+    const int stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+    auto stripBegin = [&](int s) { return (size_t)s * rowsPerStrip * filteredRow; };
+    auto stripEnd = [&](int s) { return (size_t)std::min(height, (s + 1) * rowsPerStrip) * filteredRow; };
+
+    // 1. Filter: each row only reads itself and the row above
+    std::vector<unsigned char> filtered(filteredRow * height);
+    const std::vector<unsigned char> zeroRow(rowBytes, 0);
+    pool.parallelFor(stripCount, [&](int s) {
+        std::vector<unsigned char> scratch(level > 0 ? 4 * rowBytes : 0);
+        for (int y = s * rowsPerStrip; y < std::min(height, (s + 1) * rowsPerStrip); ++y) {
+            const unsigned char* row = pixels + (size_t)y * rowBytes;
+            const unsigned char* prior = (y > 0) ? row - rowBytes : zeroRow.data();
+            filterRow(row, prior, rowBytes, channels, level > 0, scratch.data(),
+                      filtered.data() + (size_t)y * filteredRow);
+        }
+    });
+
+    // 2. Deflate each strip (primed with the filtered bytes before it) and checksum it
+    struct Strip {
+        std::vector<unsigned char> bytes;
+        uint32_t adler = 1;
+        uint32_t crc = 0;
+    };
+    std::vector<Strip> strips(stripCount);
+    pool.parallelFor(stripCount, [&](int s) {
+        const size_t begin = stripBegin(s), end = stripEnd(s);
+        compressStrip(filtered.data(), begin, end, level, s == 0, s == stripCount - 1, strips[s].bytes);
+        strips[s].adler = adler32(filtered.data() + begin, end - begin);
+    });
+
+    // 3. Combine the strip checksums into the zlib trailer
+    uint32_t adler = strips[0].adler;
+    for (int s = 1; s < stripCount; ++s) adler = adler32Combine(adler, strips[s].adler, stripEnd(s) - stripBegin(s));
+    putBigEndian(strips.back().bytes, adler);
+
+    // 4. One IDAT chunk per strip, CRCs in parallel
+    pool.parallelFor(stripCount, [&](int s) {
+        strips[s].crc = chunkCrc("IDAT", strips[s].bytes.data(), strips[s].bytes.size());
+    });
+
+    size_t total = 8 + 25 + 12;
+    for (const Strip& strip : strips) total += 12 + strip.bytes.size();
+    png.reserve(total);
+
+    putHeader(png, width, height, channels);
+    for (const Strip& strip : strips) putChunk(png, "IDAT", strip.bytes.data(), strip.bytes.size(), strip.crc);
+    putChunk(png, "IEND", nullptr, 0, chunkCrc("IEND", nullptr, 0));
+    return png;
+}
+
+bool PngEncoder::write(const std::string& path, const unsigned char* pixels, int width, int height,
+                       int channels) const {
+    std::vector<unsigned char> png = encode(pixels, width, height, channels);
+    if (png.empty()) return false;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(png.data()), (std::streamsize)png.size());
+    return (bool)file;
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+
+PngStream::PngStream(ThreadPool& pool, int level) : pool(pool), level(clampLevel(level)) {}
+
+bool PngStream::open(const std::string& path, int width, int height, int channels) {
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) return false;
+    this->width = width;
+    this->height = height;
+    this->channels = channels;
+    rowBytes = (size_t)width * channels;
+    rowsPerStrip = (int)std::max<size_t>(1, STRIP_BYTES / (rowBytes + 1));  // same strips as encode
+    stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+    rowsReceived = 0;
+    stripsWritten = 0;
+    adler = 1;
+    historyBytes = 0;
+    pending.clear();
+    priorRow.assign(rowBytes, 0);
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    std::vector<unsigned char> header;
+    putHeader(header, width, height, channels);
+    file.write(reinterpret_cast<const char*>(header.data()), (std::streamsize)header.size());
+    return (bool)file;
+}
+
+bool PngStream::writeRows(const unsigned char* rows, int count) {
+    if (!file.is_open() || count < 0 || count > height - rowsReceived) return false;
+    if (count == 0) return true;
+
+    // Filter in parallel chunks of rows; the first row's prior is the previous band's last row
+    const size_t filteredRow = rowBytes + 1;
+    const size_t offset = pending.size();
+    pending.resize(offset + (size_t)count * filteredRow);
+    const int chunkRows = rowsPerStrip;
+    pool.parallelFor((count + chunkRows - 1) / chunkRows, [&](int chunk) {
+        std::vector<unsigned char> scratch(level > 0 ? 4 * rowBytes : 0);
+        for (int y = chunk * chunkRows; y < std::min(count, (chunk + 1) * chunkRows); ++y) {
+            const unsigned char* row = rows + (size_t)y * rowBytes;
+            const unsigned char* prior = (y > 0) ? row - rowBytes : priorRow.data();
+            filterRow(row, prior, rowBytes, channels, level > 0, scratch.data(),
+                      pending.data() + offset + (size_t)y * filteredRow);
+        }
+    });
+    std::memcpy(priorRow.data(), rows + (size_t)(count - 1) * rowBytes, rowBytes);
+    rowsReceived += count;
+    return flushStrips();
+}
+
+// Deflate and write every strip whose rows have all arrived, then drop the
+// bytes that no later strip can refer to
+bool PngStream::flushStrips() {
+    const int ready = (rowsReceived == height) ? stripCount : rowsReceived / rowsPerStrip;
+    const int count = ready - stripsWritten;
+    if (count <= 0) return true;
+
+    const size_t stripBytes = (size_t)rowsPerStrip * (rowBytes + 1);
+    const size_t available = pending.size() - historyBytes;
+    auto stripBegin = [&](int s) { return historyBytes + (size_t)s * stripBytes; };
+    auto stripEnd = [&](int s) { return historyBytes + std::min((size_t)(s + 1) * stripBytes, available); };
+
+    struct Strip {
+        std::vector<unsigned char> bytes;
+        uint32_t adler = 1;
+        uint32_t crc = 0;
+    };
+    std::vector<Strip> strips(count);
+    pool.parallelFor(count, [&](int s) {
+        const int index = stripsWritten + s;
+        compressStrip(pending.data(), stripBegin(s), stripEnd(s), level, index == 0, index == stripCount - 1,
+                      strips[s].bytes);
+        strips[s].adler = adler32(pending.data() + stripBegin(s), stripEnd(s) - stripBegin(s));
+    });
+
+    for (int s = 0; s < count; ++s) adler = adler32Combine(adler, strips[s].adler, stripEnd(s) - stripBegin(s));
+    if (ready == stripCount) putBigEndian(strips.back().bytes, adler);
+
+    pool.parallelFor(count, [&](int s) {
+        strips[s].crc = chunkCrc("IDAT", strips[s].bytes.data(), strips[s].bytes.size());
+    });
+    std::vector<unsigned char> chunks;
+    for (const Strip& strip : strips) {
+        chunks.clear();
+        putChunk(chunks, "IDAT", strip.bytes.data(), strip.bytes.size(), strip.crc);
+        file.write(reinterpret_cast<const char*>(chunks.data()), (std::streamsize)chunks.size());
+    }
+    stripsWritten = ready;
+
+    // Keep the window before the next strip (MAX_DISTANCE bytes, as encode primes it)
+    const size_t consumed = stripEnd(count - 1);
+    const size_t keep = std::min(consumed, MAX_DISTANCE);
+    pending.erase(pending.begin(), pending.begin() + (consumed - keep));
+    historyBytes = keep;
+    return (bool)file;
+}
+
+bool PngStream::finish() {
+    if (!file.is_open()) return false;
+    const bool complete = rowsReceived == height && stripsWritten == stripCount;
+    if (complete) {
+        std::vector<unsigned char> end;
+        putChunk(end, "IEND", nullptr, 0, chunkCrc("IEND", nullptr, 0));
+        file.write(reinterpret_cast<const char*>(end.data()), (std::streamsize)end.size());
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+    file.close();
+    return complete && !file.fail();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// Parallel PNG encoder. The image is cut into horizontal strips that are
+// filtered and deflated independently on the thread pool and stitched into one
+// zlib stream:
+// - every strip but the last ends with an empty stored block (a sync flush),
+//   so the strips' compressed bytes can simply be concatenated
+// - a strip's matcher is primed with the 32 KB of filtered rows before it, so
+//   back references still cross strip boundaries
+// - the Adler-32 of each strip is computed in parallel and combined
+// - every strip is written as its own IDAT chunk, so CRCs are parallel too
+// The deflate coder uses fixed Huffman codes (like stb_image_write), with
+// hash-chain matching and lazy evaluation; the output is a standard PNG.
+class PngEncoder {
+public:
+    static const int MIN_LEVEL = 0;      // 0: stored blocks only (no compression)
+    static const int MAX_LEVEL = 9;      // 9: longest match search
+    static const int DEFAULT_LEVEL = 6;
+
+    // Constructor: strips are processed on pool; level is clamped to [MIN_LEVEL, MAX_LEVEL]
+    explicit PngEncoder(ThreadPool& pool, int level = DEFAULT_LEVEL);
+
+    // Encode 8-bit pixels (channels = 1 gray, 2 gray+alpha, 3 RGB, 4 RGBA; rows top to bottom)
+    std::vector<unsigned char> encode(const unsigned char* pixels, int width, int height, int channels) const;
+
+    // Encode and write to path; returns false on invalid input or I/O errors
+    bool write(const std::string& path, const unsigned char* pixels, int width, int height, int channels) const;
+
+    int getLevel() const { return level; }
+
+private:
+    ThreadPool& pool;
+    int level;
+};
+
+// PngEncoder for an image that arrives a band of rows at a time, top to bottom,
+// so the whole image never has to be in memory. Rows are filtered as they
+// arrive (against the last row of the previous band); every complete strip
+// is deflated on the pool and written as an IDAT chunk at once, with the
+// Adler-32 carried along. Only the rows of the unfinished strip and the 32 KB
+// window before it are kept. The file is byte-identical to PngEncoder::write.
+class PngStream {
+public:
+    // Constructor: as PngEncoder
+    explicit PngStream(ThreadPool& pool, int level = PngEncoder::DEFAULT_LEVEL);
+
+    // Create the file and write the header; false on invalid sizes or I/O errors
+    bool open(const std::string& path, int width, int height, int channels);
+
+    // Append the next count rows (8-bit pixels, width * channels bytes per row);
+    // false on I/O errors or rows past the image height
+    bool writeRows(const unsigned char* rows, int count);
+
+    // Write the end of the file after the last row and close; false on I/O
+    // errors or if rows are missing
+    bool finish();
+
+private:
+    bool flushStrips();
+
+    ThreadPool& pool;
+    const int level;
+    std::ofstream file;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    size_t rowBytes = 0;
+    int rowsPerStrip = 1;
+    int stripCount = 0;
+    int rowsReceived = 0;
+    int stripsWritten = 0;
+    uint32_t adler = 1;
+    size_t historyBytes = 0;               // window bytes at the front of pending
+    std::vector<unsigned char> pending;    // window + filtered rows not yet deflated
+    std::vector<unsigned char> priorRow;   // last row received (zero before the first)
+};
@@ -4,29 +4,36 @@
 #include <string>
 #include <limits>
 
-#include "RayCast.h"
-
 using Vec3 = glm::vec3;
 
 // Material types for primitives
-enum MaterialType {
+enum MaterialType : unsigned char {
     STANDARD,  // Regular diffuse material
     MIRROR,    // Reflective surface
     GLASS      // Transparent/refractive material
 };
 
-// Base class for all geometric primitives in the scene
+// Concrete primitive types (the set is closed: every Primitive is one of these)
+enum PrimitiveKind : unsigned char {
+    SPHERE_PRIMITIVE,
+    PLANE_PRIMITIVE
+};
+
+// Base class for all geometric primitives in the scene, as parsed.
+// Rendering does not use these objects: SceneSnapshot compiles them into
+// Surface records (see Surface.h), which the render threads read instead.
 class Primitive {
 protected:
+    PrimitiveKind kind;     // Concrete type (sphere/plane)
     MaterialType material;  // Type of material (standard/mirror/glass)
     Vec3 color;             // Base color (RGB)
     float shininess;         // Specular shininess exponent
     bool colorSet;           // Whether color has been set
 
 public:
-    // Constructor: initialize with material type
-    Primitive(MaterialType m)
-        : material(m), color(0.0f), shininess(0.0f), colorSet(false) {}
+    // Constructor: initialize with concrete type and material type
+    Primitive(PrimitiveKind k, MaterialType m)
+        : kind(k), material(m), color(0.0f), shininess(0.0f), colorSet(false) {}
 
     virtual ~Primitive() = default;
 
@@ -40,14 +47,14 @@ public:
     Vec3 get_rgb() const { return color; }
 
     // Material type queries
+    MaterialType get_material() const { return material; }
     bool is_normal() const { return material == STANDARD; }
     bool is_reflective() const { return material == MIRROR; }
     bool is_transparent() const { return material == GLASS; }
 
-    // Virtual methods to be implemented by derived classes
-    virtual bool is_plane() const = 0;
-    virtual Vec3 get_normal(const Vec3& p) const = 0;
-    virtual Vec3 get_intersection(RayCast ray) = 0;
+    // Concrete type queries
+    PrimitiveKind get_kind() const { return kind; }
+    bool is_plane() const { return kind == PLANE_PRIMITIVE; }
 
     // Get shininess value
     float get_shininess() const { return shininess; }
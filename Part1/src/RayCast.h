@@ -5,7 +5,7 @@
 class RayCast {
 private:
     glm::vec3 origin;    // Starting point of ray
-    glm::vec3 dir;       // Direction vector (not necessarily normalized)
+    glm::vec3 dir;       // Direction vector (normalized by the caller, so t is a distance)
 
 public:
     // Constructor: create ray from origin and direction
@@ -0,0 +1,240 @@
+#include "RayPacket.h"
+
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PACKET_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PACKET_KERNEL_SSE
+#endif
+
+// ============================================================================
+// SIMD LANE HELPERS (8 lanes with AVX2, 4 with SSE)
+// ============================================================================
+
+#if defined(PACKET_KERNEL_AVX2)
+typedef __m256 vfloat;
+static const int VWIDTH = 8;
+static inline vfloat vset(float x) { return _mm256_set1_ps(x); }
+static inline vfloat vload(const float* p) { return _mm256_load_ps(p); }
+static inline void vstore(float* p, vfloat a) { _mm256_store_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vsqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat vlt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline vfloat vle(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline vfloat vgt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vfloat vselect(vfloat m, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, m); }
+static inline vfloat vnan(vfloat a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+static inline int vmask(vfloat m) { return _mm256_movemask_ps(m); }
+// See SphereBlock.cpp: unoptimized builds do not clear the upper halves themselves
+static inline void vleave() { _mm256_zeroupper(); }
+#elif defined(PACKET_KERNEL_SSE)
+typedef __m128 vfloat;
+static const int VWIDTH = 4;
+static inline vfloat vset(float x) { return _mm_set1_ps(x); }
+static inline vfloat vload(const float* p) { return _mm_load_ps(p); }
+static inline void vstore(float* p, vfloat a) { _mm_store_ps(p, a); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vsqrt(vfloat a) { return _mm_sqrt_ps(a); }
+static inline vfloat vand(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat vlt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+static inline vfloat vle(vfloat a, vfloat b) { return _mm_cmple_ps(a, b); }
+static inline vfloat vgt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline vfloat vge(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat vselect(vfloat m, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline vfloat vnan(vfloat a) { return _mm_cmpunord_ps(a, a); }
+static inline int vmask(vfloat m) { return _mm_movemask_ps(m); }
+static inline void vleave() {}
+#endif
+
+// ============================================================================
+// PACKET SETUP
+// ============================================================================
+
+// Store direction and its reciprocal (for slab tests) in the lane
+void RayPacket::setRay(int lane, const RayCast& ray) {
+    origin = ray.getOrigin();
+    const Vec3& d = ray.getDirection();
+    dx[lane] = d.x;
+    dy[lane] = d.y;
+    dz[lane] = d.z;
+    invX[lane] = 1.0f / d.x;
+    invY[lane] = 1.0f / d.y;
+    invZ[lane] = 1.0f / d.z;
+    activeMask |= 1 << lane;
+}
+
+// Store origin, direction and reciprocal direction in the next lane
+void ShadowBatch::add(const RayCast& ray, float rayTmax) {
+    const Vec3& o = ray.getOrigin();
+    const Vec3& d = ray.getDirection();
+    ox[count] = o.x;
+    oy[count] = o.y;
+    oz[count] = o.z;
+    dx[count] = d.x;
+    dy[count] = d.y;
+    dz[count] = d.z;
+    invX[count] = 1.0f / d.x;
+    invY[count] = 1.0f / d.y;
+    invZ[count] = 1.0f / d.z;
+    tmax[count] = rayTmax;
+    ++count;
+}
+
+// No lane has a hit; all search up to tmax
+void PacketHit::reset(float tmax) {
+    for (int i = 0; i < RayPacket::SIZE; ++i) {
+        t[i] = tmax;
+        prim[i] = nullptr;
+    }
+}
+
+bool packetKernelsAvailable() {
+#if defined(PACKET_KERNEL_AVX2) || defined(PACKET_KERNEL_SSE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ============================================================================
+// PACKET KERNELS
+// ============================================================================
+
+#if defined(PACKET_KERNEL_AVX2) || defined(PACKET_KERNEL_SSE)
+
+// Slab test for every lane group; a group is skipped when none of its lanes is in mask
+int packetIntersectBox(const RayPacket& packet, const Vec3& lo, const Vec3& hi,
+                       const float* t, int mask) {
+    const vfloat loX = vset(lo.x - packet.origin.x), hiX = vset(hi.x - packet.origin.x);
+    const vfloat loY = vset(lo.y - packet.origin.y), hiY = vset(hi.y - packet.origin.y);
+    const vfloat loZ = vset(lo.z - packet.origin.z), hiZ = vset(hi.z - packet.origin.z);
+    const vfloat zero = vset(0.0f);
+
+    int result = 0;
+    for (int k = 0; k < RayPacket::SIZE; k += VWIDTH) {
+        const int groupMask = (mask >> k) & ((1 << VWIDTH) - 1);
+        if (groupMask == 0) continue;
+
+        vfloat t0 = vmul(loX, vload(packet.invX + k)), t1 = vmul(hiX, vload(packet.invX + k));
+        vfloat tNear = vmin(t0, t1), tFar = vmax(t0, t1);
+        t0 = vmul(loY, vload(packet.invY + k));
+        t1 = vmul(hiY, vload(packet.invY + k));
+        tNear = vmax(tNear, vmin(t0, t1));
+        tFar = vmin(tFar, vmax(t0, t1));
+        t0 = vmul(loZ, vload(packet.invZ + k));
+        t1 = vmul(hiZ, vload(packet.invZ + k));
+        tNear = vmax(tNear, vmin(t0, t1));
+        tFar = vmin(tFar, vmax(t0, t1));
+
+        vfloat inside = vand(vge(tFar, vmax(tNear, zero)), vlt(tNear, vload(t + k)));
+        result |= (vmask(inside) & groupMask) << k;
+    }
+    vleave();
+    return result;
+}
+
+// One sphere against all lanes: the packet shares its origin, so c - o and
+// |c - o|^2 are computed once and only the projection differs per lane
+int packetIntersectSphere(const RayPacket& packet, const Vec3& center, float radiusSq,
+                          float tmin, float* t, int mask) {
+    const float ocx = center.x - packet.origin.x;
+    const float ocy = center.y - packet.origin.y;
+    const float ocz = center.z - packet.origin.z;
+    const vfloat vocx = vset(ocx), vocy = vset(ocy), vocz = vset(ocz);
+    const vfloat lenSq = vset((ocx * ocx + ocy * ocy) + ocz * ocz);
+    const vfloat radSq = vset(radiusSq);
+    const vfloat vtmin = vset(tmin);
+
+    int result = 0;
+    for (int k = 0; k < RayPacket::SIZE; k += VWIDTH) {
+        const int groupMask = (mask >> k) & ((1 << VWIDTH) - 1);
+        if (groupMask == 0) continue;
+
+        vfloat proj = vadd(vadd(vmul(vload(packet.dx + k), vocx), vmul(vload(packet.dy + k), vocy)),
+                           vmul(vload(packet.dz + k), vocz));
+        vfloat distSq = vsub(lenSq, vmul(proj, proj));
+        vfloat inside = vle(distSq, radSq);
+
+        // Misses produce NaN here; they are masked out by inside
+        vfloat halfChord = vsqrt(vsub(radSq, distSq));
+        vfloat tNear = vsub(proj, halfChord);
+        vfloat tCand = vselect(vgt(tNear, vtmin), tNear, vadd(proj, halfChord));
+
+        vfloat tOld = vload(t + k);
+        vfloat closer = vand(inside, vand(vgt(tCand, vtmin), vlt(tCand, tOld)));
+        int closerMask = vmask(closer) & groupMask;
+        if (closerMask == 0) continue;
+
+        vstore(t + k, vselect(closer, tCand, tOld));
+        result |= closerMask << k;
+    }
+    vleave();
+    return result;
+}
+
+// Entry and exit distance of one slab; a NaN bound (origin on the plane of a
+// slab the ray is parallel to) takes the other bound's value, as fmin/fmax do
+static inline void slab(vfloat t0, vfloat t1, vfloat& tNear, vfloat& tFar) {
+    t0 = vselect(vnan(t0), t1, t0);
+    t1 = vselect(vnan(t1), t0, t1);
+    tNear = vmin(t0, t1);
+    tFar = vmax(t0, t1);
+}
+
+// Slab test per lane group with per-lane origins; evaluates the scalar test's
+// expressions, (lo - o) * invDir, so culling matches single rays exactly
+uint32_t shadowIntersectBox(const ShadowBatch& batch, const Vec3& lo, const Vec3& hi, uint32_t mask) {
+    const vfloat loX = vset(lo.x), loY = vset(lo.y), loZ = vset(lo.z);
+    const vfloat hiX = vset(hi.x), hiY = vset(hi.y), hiZ = vset(hi.z);
+    const vfloat zero = vset(0.0f);
+
+    uint32_t result = 0;
+    for (int k = 0; k < batch.count; k += VWIDTH) {
+        const uint32_t groupMask = (mask >> k) & ((1u << VWIDTH) - 1);
+        if (groupMask == 0) continue;
+
+        vfloat nearX, farX, nearY, farY, nearZ, farZ;
+        const vfloat ox = vload(batch.ox + k), oy = vload(batch.oy + k), oz = vload(batch.oz + k);
+        const vfloat invX = vload(batch.invX + k), invY = vload(batch.invY + k), invZ = vload(batch.invZ + k);
+        slab(vmul(vsub(loX, ox), invX), vmul(vsub(hiX, ox), invX), nearX, farX);
+        slab(vmul(vsub(loY, oy), invY), vmul(vsub(hiY, oy), invY), nearY, farY);
+        slab(vmul(vsub(loZ, oz), invZ), vmul(vsub(hiZ, oz), invZ), nearZ, farZ);
+        const vfloat tNear = vmax(vmax(nearX, nearY), nearZ);
+        const vfloat tFar = vmin(vmin(farX, farY), farZ);
+
+        vfloat inside = vand(vge(tFar, vmax(tNear, zero)), vlt(tNear, vload(batch.tmax + k)));
+        result |= ((uint32_t)vmask(inside) & groupMask) << k;
+    }
+    vleave();
+    return result;
+}
+
+#else
+
+// Without SIMD the BVH traces packets ray by ray; these are never called
+int packetIntersectBox(const RayPacket&, const Vec3&, const Vec3&, const float*, int mask) {
+    return mask;
+}
+
+int packetIntersectSphere(const RayPacket&, const Vec3&, float, float, float*, int) {
+    return 0;
+}
+
+uint32_t shadowIntersectBox(const ShadowBatch&, const Vec3&, const Vec3&, uint32_t mask) {
+    return mask;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "RayCast.h"
+
+using Vec3 = glm::vec3;
+
+struct Surface;
+
+// Packet of up to 16 coherent primary rays (a 4x4 pixel block) sharing one origin.
+// Directions are stored as structure-of-arrays so SIMD lanes map to rays.
+// activeMask marks lanes that hold a ray (blocks on the image border may be partial).
+struct RayPacket {
+    static const int DIM = 4;             // packet covers DIM x DIM pixels
+    static const int SIZE = DIM * DIM;    // rays per packet
+
+    Vec3 origin = Vec3(0.0f);
+    alignas(32) float dx[SIZE] = {}, dy[SIZE] = {}, dz[SIZE] = {};
+    alignas(32) float invX[SIZE] = {}, invY[SIZE] = {}, invZ[SIZE] = {};
+    int activeMask = 0;
+
+    // Store ray in lane (origin must be the same for every lane)
+    void setRay(int lane, const RayCast& ray);
+
+    // Direction of lane as a vector
+    Vec3 direction(int lane) const { return Vec3(dx[lane], dy[lane], dz[lane]); }
+};
+
+// Per-lane closest hits of a packet query
+struct PacketHit {
+    alignas(32) float t[RayPacket::SIZE];
+    const Surface* prim[RayPacket::SIZE];
+
+    // Reset every lane to "no hit" up to tmax
+    void reset(float tmax);
+};
+
+// Shadow rays of one shading point, one per light (see BVH::occludedMask).
+// Unlike a RayPacket each ray has its own origin (offset along its direction)
+// and its own tmax; bit i of a mask stands for ray i.
+struct ShadowBatch {
+    static const int SIZE = 32;
+
+    alignas(32) float ox[SIZE] = {}, oy[SIZE] = {}, oz[SIZE] = {};
+    alignas(32) float dx[SIZE] = {}, dy[SIZE] = {}, dz[SIZE] = {};
+    alignas(32) float invX[SIZE] = {}, invY[SIZE] = {}, invZ[SIZE] = {};
+    alignas(32) float tmax[SIZE] = {};
+    int count = 0;
+
+    // Append a ray searched inside (tmin, rayTmax) (at most SIZE rays)
+    void add(const RayCast& ray, float rayTmax);
+
+    Vec3 origin(int i) const { return Vec3(ox[i], oy[i], oz[i]); }
+    Vec3 direction(int i) const { return Vec3(dx[i], dy[i], dz[i]); }
+};
+
+// Whether the packet kernels below are SIMD (otherwise packets are traced ray by ray)
+bool packetKernelsAvailable();
+
+// Lanes of mask whose ray enters box [lo, hi] before their current closest hit t
+int packetIntersectBox(const RayPacket& packet, const Vec3& lo, const Vec3& hi,
+                       const float* t, int mask);
+
+// Test the lanes of mask against one sphere; lanes with a hit inside (tmin, t)
+// get their t lowered. Returns the mask of updated lanes.
+// Evaluates the same expressions as the SphereBlock kernel, so results match single rays.
+int packetIntersectSphere(const RayPacket& packet, const Vec3& center, float radiusSq,
+                          float tmin, float* t, int mask);
+
+// Rays of mask that enter box [lo, hi] before their tmax. Gives the same
+// answer as the BVH's scalar slab test (NaN slabs are dropped like fmin/fmax do).
+uint32_t shadowIntersectBox(const ShadowBatch& batch, const Vec3& lo, const Vec3& hi, uint32_t mask);
@@ -0,0 +1,196 @@
+#include "raytracer.h"
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "Renderer.h"
+
+// C API over the rendering engine (see raytracer.h). No C++ exception may
+// cross this boundary: every entry point catches and returns a status.
+
+struct rt_renderer {
+    ThreadPool pool;
+
+    explicit rt_renderer(unsigned threadCount) : pool(threadCount) {}
+};
+
+struct rt_scene {
+    std::unique_ptr<SceneSnapshot> snapshot;
+    CameraBasis camera;   // starts as the scene's camera; rt_scene_set_camera replaces it
+    int maxDepth = DEFAULT_MAX_DEPTH;
+};
+
+// Copy message into the caller's error buffer (truncated, always terminated)
+static void reportError(const std::string& message, char* error, size_t errorSize) {
+    if (!error || errorSize == 0) return;
+    size_t length = message.size() < errorSize - 1 ? message.size() : errorSize - 1;
+    std::memcpy(error, message.data(), length);
+    error[length] = '\0';
+}
+
+static rt_scene* wrapScene(SceneSnapshot* snapshot, const std::string& message, char* error, size_t errorSize) {
+    if (!snapshot) {
+        reportError(message, error, errorSize);
+        return nullptr;
+    }
+    rt_scene* scene = new rt_scene;
+    scene->snapshot.reset(snapshot);
+    scene->camera = snapshot->getCamera();
+    return scene;
+}
+
+// rt_render renders bands of this many rows and copies each one into the
+// caller's rows while the next renders, so no full frame is allocated
+static const int RENDER_BAND_ROWS = 64;
+
+// Copy a rendered band into the caller's rows
+static void copyPixels(const ImageBuffer& image, rt_pixel_format format, unsigned char* pixels, size_t rowStride) {
+    for (int y = 0; y < image.height; ++y) {
+        unsigned char* row = pixels + y * rowStride;
+        const size_t first = (size_t)y * image.width;
+        switch (format) {
+        case RT_PIXEL_RGB8:
+            std::memcpy(row, &image.rgb[3 * first], 3 * (size_t)image.width);
+            break;
+        case RT_PIXEL_RGBA8:
+            for (int x = 0; x < image.width; ++x) {
+                std::memcpy(row + 4 * x, &image.rgb[3 * (first + x)], 3);
+                row[4 * x + 3] = 255;
+            }
+            break;
+        case RT_PIXEL_RGB32F:
+            std::memcpy(row, &image.radiance[3 * first], 3 * sizeof(float) * image.width);
+            break;
+        }
+    }
+}
+
+static size_t bytesPerPixel(rt_pixel_format format) {
+    switch (format) {
+    case RT_PIXEL_RGB8: return 3;
+    case RT_PIXEL_RGBA8: return 4;
+    case RT_PIXEL_RGB32F: return 3 * sizeof(float);
+    }
+    return 0;
+}
+
+extern "C" {
+
+int rt_version(void) {
+    return RT_API_VERSION;
+}
+
+rt_renderer* rt_renderer_create(unsigned thread_count) {
+    try {
+        return new rt_renderer(thread_count);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void rt_renderer_destroy(rt_renderer* renderer) {
+    delete renderer;
+}
+
+rt_scene* rt_scene_create(const char* text, size_t length, char* error, size_t error_size) {
+    if (!text && length > 0) {
+        reportError("scene text is null", error, error_size);
+        return nullptr;
+    }
+    try {
+        std::string message;
+        SceneSnapshot* snapshot = compileSceneText(text, length, "scene", message);
+        return wrapScene(snapshot, message, error, error_size);
+    } catch (const std::bad_alloc&) {
+        reportError("out of memory", error, error_size);
+    } catch (...) {
+        reportError("internal error", error, error_size);
+    }
+    return nullptr;
+}
+
+rt_scene* rt_scene_load(const char* path, char* error, size_t error_size) {
+    if (!path) {
+        reportError("path is null", error, error_size);
+        return nullptr;
+    }
+    try {
+        std::string message;
+        SceneSnapshot* snapshot = loadScene(path, message);
+        return wrapScene(snapshot, message, error, error_size);
+    } catch (const std::bad_alloc&) {
+        reportError("out of memory", error, error_size);
+    } catch (...) {
+        reportError("internal error", error, error_size);
+    }
+    return nullptr;
+}
+
+void rt_scene_destroy(rt_scene* scene) {
+    delete scene;
+}
+
+int rt_scene_get_camera(const rt_scene* scene, rt_camera* camera) {
+    if (!scene || !camera) return RT_ERROR_ARGUMENT;
+    const CameraBasis& view = scene->camera;
+    for (int i = 0; i < 3; ++i) {
+        camera->eye[i] = view.eye[i];
+        camera->forward[i] = view.forward[i];
+        camera->up[i] = view.up[i];
+    }
+    camera->focal_length = view.focalLength;
+    camera->viewport_width = view.viewportWidth;
+    camera->viewport_height = view.viewportHeight;
+    return RT_OK;
+}
+
+int rt_scene_set_camera(rt_scene* scene, const rt_camera* camera) {
+    if (!scene || !camera) return RT_ERROR_ARGUMENT;
+    CameraBasis view;
+    view.eye = Vec3(camera->eye[0], camera->eye[1], camera->eye[2]);
+    view.forward = Vec3(camera->forward[0], camera->forward[1], camera->forward[2]);
+    view.up = Vec3(camera->up[0], camera->up[1], camera->up[2]);
+    view.focalLength = camera->focal_length;
+    view.viewportWidth = camera->viewport_width;
+    view.viewportHeight = camera->viewport_height;
+    // A degenerate basis would turn every ray into NaNs
+    if (glm::length(glm::cross(view.forward, view.up)) == 0.0f || view.viewportHeight <= 0.0f ||
+        view.viewportWidth < 0.0f) {
+        return RT_ERROR_ARGUMENT;
+    }
+    scene->camera = view;
+    return RT_OK;
+}
+
+int rt_scene_set_max_depth(rt_scene* scene, int max_depth) {
+    if (!scene || max_depth < 0) return RT_ERROR_ARGUMENT;
+    scene->maxDepth = max_depth;
+    return RT_OK;
+}
+
+int rt_render(rt_renderer* renderer, const rt_scene* scene, int width, int height,
+              rt_pixel_format format, void* pixels, size_t row_stride, unsigned flags) {
+    const size_t pixelBytes = bytesPerPixel(format);
+    if (!renderer || !scene || !pixels || width <= 0 || height <= 0 || pixelBytes == 0 ||
+        row_stride < pixelBytes * width) {
+        return RT_ERROR_ARGUMENT;
+    }
+    try {
+        RenderContext context(*scene->snapshot, scene->camera, width, height, (flags & RT_RENDER_PACKETS) != 0,
+                              scene->maxDepth, (flags & RT_RENDER_WAVEFRONT) != 0);
+        unsigned char* row = static_cast<unsigned char*>(pixels);
+        renderBands(context, RENDER_BAND_ROWS, format == RT_PIXEL_RGB32F, renderer->pool,
+                    [&](const ImageBuffer& band) {
+                        copyPixels(band, format, row, row_stride);
+                        row += band.height * row_stride;
+                        return true;
+                    });
+        return RT_OK;
+    } catch (...) {
+        return RT_ERROR_INTERNAL;
+    }
+}
+
+}
@@ -0,0 +1,413 @@
+#include "RenderDaemon.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "ImageWriter.h"
+#include "Renderer.h"
+
+// Longest request line accepted; longer lines close the connection
+static const size_t MAX_LINE = 4096;
+
+struct RenderDaemon::Job {
+    int priority = 0;
+    uint64_t sequence = 0;               // arrival order, breaks priority ties
+    std::string scenePath;
+    std::string outputPath;              // empty: results/<scene>.<format>
+    std::string format;                  // empty: from outputPath, else png
+    int width = 800;
+    int height = 800;
+    bool packets = false;
+    bool wavefront = false;
+    int maxDepth = DEFAULT_MAX_DEPTH;
+    bool setEye = false, setForward = false, setUp = false, setFocal = false;
+    Vec3 eye, forward, up;
+    float focal = 1.0f;
+    Clock::time_point queuedAt;
+    std::promise<std::string> reply;     // the response line
+};
+
+// Heap order: higher priority first, then earlier arrival
+struct RenderDaemon::JobOrder {
+    bool operator()(const std::unique_ptr<Job>& a, const std::unique_ptr<Job>& b) const {
+        if (a->priority != b->priority) return a->priority < b->priority;
+        return a->sequence > b->sequence;
+    }
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string formatNumber(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f", value);
+    return text;
+}
+
+// Parse "X,Y,Z"
+static bool parseVector(const std::string& text, Vec3& out) {
+    float values[3];
+    const char* cursor = text.c_str();
+    for (int i = 0; i < 3; ++i) {
+        char* end = nullptr;
+        values[i] = std::strtof(cursor, &end);
+        if (end == cursor || *end != (i < 2 ? ',' : '\0')) return false;
+        cursor = end + 1;
+    }
+    out = Vec3(values[0], values[1], values[2]);
+    return true;
+}
+
+static bool parseInt(const std::string& text, int& out) {
+    char* end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || value < -1000000 || value > 1000000) return false;
+    out = (int)value;
+    return true;
+}
+
+RenderDaemon::RenderDaemon(ThreadPool& pool, const DaemonSettings& settings)
+    : pool(pool), settings(settings), cache(settings.cacheCapacity), startTime(Clock::now()) {}
+
+RenderDaemon::~RenderDaemon() = default;
+
+// ============================================================================
+// REQUESTS
+// ============================================================================
+
+std::string RenderDaemon::handleRequest(const std::string& line) {
+    std::istringstream stream(line);
+    std::vector<std::string> words;
+    for (std::string word; stream >> word;) words.push_back(word);
+    if (words.empty()) return "error empty request";
+
+    if (words[0] == "render") return submitRender(words);
+    if (words[0] == "stats") return statsLine();
+    if (words[0] == "shutdown") {
+        std::lock_guard<std::mutex> guard(queueLock);
+        stopping = true;
+        queueReady.notify_all();
+        return "ok";
+    }
+    return "error unknown request '" + words[0] + "' (render, stats, shutdown)";
+}
+
+// Parse a render request, queue it and wait for its result
+std::string RenderDaemon::submitRender(const std::vector<std::string>& words) {
+    if (words.size() < 2) return "error render needs a scene path";
+    std::unique_ptr<Job> job(new Job);
+    job->scenePath = words[1];
+    job->packets = settings.packetTracing;
+    job->wavefront = settings.wavefront;
+    job->maxDepth = settings.maxDepth;
+    for (size_t i = 2; i < words.size(); ++i) {
+        const std::string& word = words[i];
+        size_t equals = word.find('=');
+        std::string key = word.substr(0, equals);
+        std::string value = (equals == std::string::npos) ? "" : word.substr(equals + 1);
+        bool valid = true;
+        if (word == "packets") {
+            job->packets = true;
+        } else if (word == "wavefront") {
+            job->wavefront = true;
+        } else if (key == "out") {
+            job->outputPath = value;
+            valid = !value.empty();
+        } else if (key == "format") {
+            job->format = value;
+            valid = !value.empty();
+        } else if (key == "size") {
+            size_t x = value.find('x');
+            valid = x != std::string::npos && parseInt(value.substr(0, x), job->width) &&
+                    parseInt(value.substr(x + 1), job->height) &&
+                    job->width > 0 && job->height > 0 && job->width <= 16384 && job->height <= 16384;
+        } else if (key == "priority") {
+            valid = parseInt(value, job->priority);
+        } else if (key == "depth") {
+            valid = parseInt(value, job->maxDepth) && job->maxDepth >= 0;
+        } else if (key == "eye") {
+            valid = job->setEye = parseVector(value, job->eye);
+        } else if (key == "forward") {
+            valid = job->setForward = parseVector(value, job->forward);
+        } else if (key == "up") {
+            valid = job->setUp = parseVector(value, job->up);
+        } else if (key == "focal") {
+            char* end = nullptr;
+            job->focal = std::strtof(value.c_str(), &end);
+            valid = job->setFocal = !value.empty() && *end == '\0' && job->focal > 0.0f;
+        } else {
+            valid = false;
+        }
+        if (!valid) return "error bad render option '" + word + "'";
+    }
+    if (job->format.empty()) {
+        job->format = job->outputPath.empty() ? "png" : ImageWriter::extensionOf(job->outputPath);
+    }
+
+    std::future<std::string> result = job->reply.get_future();
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        if (stopping || queue.size() >= settings.maxQueuedJobs) {
+            std::lock_guard<std::mutex> metricsGuard(metricsLock);
+            ++rejected;
+            return stopping ? "error shutting down" : "error queue full";
+        }
+        job->sequence = nextSequence++;
+        job->queuedAt = Clock::now();
+        queue.push_back(std::move(job));
+        std::push_heap(queue.begin(), queue.end(), JobOrder());
+    }
+    queueReady.notify_one();
+    return result.get();
+}
+
+std::string RenderDaemon::statsLine() {
+    size_t queued;
+    unsigned active;
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        queued = queue.size();
+        active = activeJobs;
+    }
+
+    std::lock_guard<std::mutex> guard(metricsLock);
+    const double uptime = millisecondsSince(startTime) / 1000.0;
+    std::vector<double> latencies = recentLatencies;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[(size_t)(p * (latencies.size() - 1))];
+    };
+
+    std::string line = "ok";
+    line += " uptime_s=" + formatNumber(uptime);
+    line += " completed=" + std::to_string(completed);
+    line += " failed=" + std::to_string(failed);
+    line += " rejected=" + std::to_string(rejected);
+    line += " queued=" + std::to_string(queued);
+    line += " active=" + std::to_string(active);
+    line += " throughput_jobs_per_s=" + formatNumber(uptime > 0 ? completed / uptime : 0.0);
+    line += " queue_ms_mean=" + formatNumber(completed ? totalQueueMs / completed : 0.0);
+    line += " render_ms_mean=" + formatNumber(completed ? totalRenderMs / completed : 0.0);
+    line += " latency_ms_p50=" + formatNumber(percentile(0.50));
+    line += " latency_ms_p95=" + formatNumber(percentile(0.95));
+    line += " latency_ms_max=" + formatNumber(maxLatencyMs);
+    line += " cache_entries=" + std::to_string(cache.size());
+    line += " cache_capacity=" + std::to_string(cache.getCapacity());
+    line += " cache_hits=" + std::to_string(cache.getHits());
+    line += " cache_misses=" + std::to_string(cache.getMisses());
+    return line;
+}
+
+// ============================================================================
+// WORKERS
+// ============================================================================
+
+void RenderDaemon::workerLoop() {
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> guard(queueLock);
+            queueReady.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;  // stopping and drained
+            std::pop_heap(queue.begin(), queue.end(), JobOrder());
+            job = std::move(queue.back());
+            queue.pop_back();
+            ++activeJobs;
+        }
+
+        const double queueMs = millisecondsSince(job->queuedAt);
+        double renderMs = 0;
+        bool cached = false;
+        std::string reply = renderJob(*job, renderMs, cached);
+        const bool ok = reply.compare(0, 3, "ok ") == 0;
+        recordLatency(queueMs, renderMs, !ok);
+        if (ok) {
+            reply += " queue_ms=" + formatNumber(queueMs) + " render_ms=" + formatNumber(renderMs) +
+                     " cached=" + (cached ? "1" : "0");
+        }
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            --activeJobs;
+        }
+        job->reply.set_value(reply);
+    }
+}
+
+// Render one job and write its image; returns the response line
+std::string RenderDaemon::renderJob(Job& job, double& renderMs, bool& cached) {
+    const Clock::time_point start = Clock::now();
+    std::unique_ptr<ImageWriter> writer = ImageWriter::create(job.format, pool, settings.pngLevel);
+    if (!writer) return "error unknown output format '" + job.format + "'";
+
+    std::string error;
+    std::shared_ptr<const SceneSnapshot> scene = cache.get(job.scenePath, error, cached);
+    if (!scene) return "error " + error;
+
+    CameraBasis view = scene->getCamera();
+    if (job.setEye) view.eye = job.eye;
+    if (job.setForward) view.forward = job.forward;
+    if (job.setUp) view.up = job.up;
+    if (job.setFocal) view.focalLength = job.focal;
+    if (glm::length(glm::cross(view.forward, view.up)) == 0.0f) return "error forward and up are parallel";
+
+    try {
+        ImageBuffer image(job.width, job.height, writer->needsRadiance());
+        RenderContext context(*scene, view, job.width, job.height, job.packets, job.maxDepth, job.wavefront);
+        renderImage(context, image, pool);
+        const std::string output = job.outputPath.empty()
+                                       ? ImageWriter::outputPathFor(job.scenePath, writer->getExtension())
+                                       : job.outputPath;
+        if (!writer->write(output, image)) return "error failed to write " + output;
+        renderMs = millisecondsSince(start);
+        return "ok " + output;
+    } catch (const std::bad_alloc&) {
+        return "error out of memory";
+    }
+}
+
+// Only completed jobs enter the times: a failed job stops before or during
+// its render, so its render time would pull the means and percentiles down
+void RenderDaemon::recordLatency(double queueMs, double renderMs, bool jobFailed) {
+    std::lock_guard<std::mutex> guard(metricsLock);
+    if (jobFailed) {
+        ++failed;
+        return;
+    }
+    ++completed;
+    totalQueueMs += queueMs;
+    totalRenderMs += renderMs;
+    const double latency = queueMs + renderMs;
+    maxLatencyMs = std::max(maxLatencyMs, latency);
+    if (recentLatencies.size() < LATENCY_WINDOW) {
+        recentLatencies.push_back(latency);
+    } else {
+        recentLatencies[nextLatency] = latency;
+    }
+    nextLatency = (nextLatency + 1) % LATENCY_WINDOW;
+}
+
+// ============================================================================
+// SOCKET SERVER
+// ============================================================================
+
+#ifdef _WIN32
+
+bool RenderDaemon::run(std::string& error) {
+    error = "daemon mode needs Unix domain sockets, which this build does not support";
+    return false;
+}
+
+void RenderDaemon::serveConnection(int) {}
+
+#else
+
+// Write all of text; false if the client went away
+static bool sendAll(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t count = ::write(fd, text.data() + sent, text.size() - sent);
+        if (count <= 0) return false;
+        sent += (size_t)count;
+    }
+    return true;
+}
+
+// Answer each request line of one client until it disconnects
+void RenderDaemon::serveConnection(int fd) {
+    std::string pending;
+    char chunk[1024];
+    bool open = true;
+    while (open) {
+        ssize_t count = ::read(fd, chunk, sizeof(chunk));
+        if (count <= 0) break;
+        pending.append(chunk, (size_t)count);
+        size_t newline;
+        while (open && (newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            open = sendAll(fd, handleRequest(line) + "\n");
+        }
+        if (pending.size() > MAX_LINE) {
+            sendAll(fd, "error request line too long\n");
+            break;
+        }
+    }
+
+    // Erase and close under the lock: once closed, accept may reuse the fd
+    // number for a new connection, which must stay in the set
+    std::lock_guard<std::mutex> guard(connectionLock);
+    connections.erase(fd);
+    ::close(fd);
+    connectionsClosed.notify_all();
+}
+
+bool RenderDaemon::run(std::string& error) {
+    // A client that disconnects before its answer must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (settings.socketPath.empty() || settings.socketPath.size() >= sizeof(address.sun_path)) {
+        error = "socket path must be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters";
+        return false;
+    }
+    settings.socketPath.copy(address.sun_path, settings.socketPath.size());
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        error = "cannot create socket";
+        return false;
+    }
+    ::unlink(settings.socketPath.c_str());  // stale socket of an earlier run
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd, 16) != 0) {
+        ::close(listenFd);
+        error = "cannot listen on " + settings.socketPath;
+        return false;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < std::max(1u, settings.workers); ++i) {
+        workers.emplace_back(&RenderDaemon::workerLoop, this);
+    }
+
+    // Accept until shutdown; poll with a timeout so the stop flag is seen
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(queueLock);
+            if (stopping) break;
+        }
+        pollfd listener = {listenFd, POLLIN, 0};
+        if (::poll(&listener, 1, 200) <= 0) continue;
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::lock_guard<std::mutex> guard(connectionLock);
+        connections.insert(fd);
+        std::thread(&RenderDaemon::serveConnection, this, fd).detach();
+    }
+    ::close(listenFd);
+    ::unlink(settings.socketPath.c_str());
+
+    // Finish the queued jobs (their clients get their answers), then wake the
+    // clients still waiting for a request and wait for them to disconnect
+    for (std::thread& worker : workers) worker.join();
+    std::unique_lock<std::mutex> guard(connectionLock);
+    for (int fd : connections) ::shutdown(fd, SHUT_RDWR);
+    connectionsClosed.wait(guard, [this] { return connections.empty(); });
+    return true;
+}
+
+#endif
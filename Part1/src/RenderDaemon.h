@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "PngEncoder.h"
+#include "Renderer.h"
+#include "SceneCache.h"
+#include "ThreadPool.h"
+
+// Daemon options set from the command line
+struct DaemonSettings {
+    std::string socketPath;         // Unix domain socket to listen on
+    size_t cacheCapacity = 16;      // compiled scenes kept warm
+    size_t maxQueuedJobs = 256;     // further render requests are rejected
+    unsigned workers = 1;           // jobs rendered at the same time
+    int pngLevel = PngEncoder::DEFAULT_LEVEL;
+    bool packetTracing = false;     // default for jobs without the packets option
+    bool wavefront = false;         // default for jobs without the wavefront option
+    int maxDepth = DEFAULT_MAX_DEPTH; // default for jobs without the depth option
+};
+
+// Long-running render server: clients connect to a Unix domain socket and
+// send one request per line, each answered by one line. Requests:
+//   render SCENE [out=FILE] [format=F] [size=WxH] [priority=N] [packets]
+//          [wavefront] [depth=N] [eye=X,Y,Z] [forward=X,Y,Z] [up=X,Y,Z] [focal=F]
+//       queue a render of SCENE (a .txt or .rtsb path, no spaces) and answer
+//       "ok FILE queue_ms=.. render_ms=.. cached=0|1" once the image is
+//       written, or "error MESSAGE". Higher priorities run first, equal ones
+//       in arrival order. The camera options replace the scene's e/f/u values.
+//   stats      answer "ok" followed by key=value metrics (the times cover
+//              completed jobs only)
+//   shutdown   finish the queued jobs, then stop
+// Compiled scenes are kept in a SceneCache, so repeated renders of one file
+// skip parsing and the BVH build. A client may keep its connection open and
+// send any number of requests; several clients are served at once.
+class RenderDaemon {
+public:
+    RenderDaemon(ThreadPool& pool, const DaemonSettings& settings);
+    ~RenderDaemon();
+
+    RenderDaemon(const RenderDaemon&) = delete;
+    RenderDaemon& operator=(const RenderDaemon&) = delete;
+
+    // Listen and serve until a shutdown request. Returns false (with error
+    // set) if the socket cannot be opened.
+    bool run(std::string& error);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job;
+    struct JobOrder;
+
+    void serveConnection(int fd);
+    std::string handleRequest(const std::string& line);
+    std::string submitRender(const std::vector<std::string>& words);
+    std::string statsLine();
+    void workerLoop();
+    std::string renderJob(Job& job, double& renderMs, bool& cached);
+    void recordLatency(double queueMs, double renderMs, bool failed);
+
+    ThreadPool& pool;
+    const DaemonSettings settings;
+    SceneCache cache;
+    const Clock::time_point startTime;
+
+    // Job queue: a binary heap ordered by JobOrder
+    std::vector<std::unique_ptr<Job>> queue;
+    uint64_t nextSequence = 0;
+    unsigned activeJobs = 0;
+    bool stopping = false;
+    std::mutex queueLock;
+    std::condition_variable queueReady;
+
+    // Open client connections, shut down to wake their readers on stop
+    std::set<int> connections;
+    std::mutex connectionLock;
+    std::condition_variable connectionsClosed;
+
+    // Metrics
+    static const size_t LATENCY_WINDOW = 1024;  // recent jobs kept for percentiles
+    unsigned long long completed = 0;
+    unsigned long long failed = 0;
+    unsigned long long rejected = 0;
+    double totalQueueMs = 0;
+    double totalRenderMs = 0;
+    double maxLatencyMs = 0;
+    std::vector<double> recentLatencies;       // ring buffer of completed jobs' queue + render times
+    size_t nextLatency = 0;
+    std::mutex metricsLock;
+};
@@ -0,0 +1,864 @@
+#include "Renderer.h"
+
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "Illumination.h"
+#include "GlobalLight.h"
+#include "ConeLight.h"
+#include "ParallelLight.h"
+#include "Primitive.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "RayCast.h"
+#include "HitResult.h"
+#include "RayPacket.h"
+#include "SceneTokenizer.h"
+#include "BoundedQueue.h"
+
+using namespace std;
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+// Default camera, before the scene's e/u/f commands
+// Implemented as stated in the PDF: Phase 1 camera defaults match the PDF (screen corners ±1)
+static CameraBasis defaultCamera() {
+    CameraBasis camera;
+    camera.eye     = Vec3(0, 0, 1);       // 1 unit in front of the Z=0 screen
+    camera.forward = Vec3(0, 0, -1);      // looks toward the screen
+    camera.up      = Vec3(0, 1, 0);
+    camera.right   = Vec3(1, 0, 0);
+
+    camera.focalLength    = 1.0f;         // screen at Z=0 from eye at Z=1
+    camera.viewportHeight = 2.0f;         // from -1 to 1
+    camera.viewportWidth  = 2.0f;         // from -1 to 1
+    return camera;
+}
+
+// Forward declarations
+bool isOccluded(const Vec3& pt, const Vec3& lightDirection, const float lightDistance, 
+                const BVH& bvh);
+
+// Calculate light direction and distance for a given light source
+// Returns true if light is valid (not blocked by cone angle), false otherwise
+// (light directions and the cone axis were normalized when the scene was compiled)
+static bool calculateLightDirection(const LightSource& light, const Vec3& pt, Vec3& outDirection, float& outDistance) {
+    if (light.isConeType()) {
+        Vec3 toLight = light.position - pt;
+        outDistance = glm::length(toLight);
+        outDirection = glm::normalize(toLight);
+        
+        // Check if point is within cone angle
+        float cosAngle = glm::dot(-outDirection, light.direction);
+        if (cosAngle < light.cosCutoff) return false;  // Outside cone
+    } else {
+        outDirection = light.direction;
+        outDistance = std::numeric_limits<float>::infinity();
+    }
+    return true;
+}
+
+// ============================================================================
+// SCENE PARSING
+// ============================================================================
+
+// Pending-assignment cursors: 'c', 'i' and 'p' lines apply to the first object
+// (or light) that does not have that attribute yet. Attributes are only ever
+// set at the first such entry and never unset, and new entries are appended,
+// so everything before a cursor stays assigned and each cursor only moves
+// forward: a whole file is parsed in linear time.
+struct ParseCursors {
+    size_t nextColor = 0;      // first object without RGB
+    size_t nextIntensity = 0;  // first non-ambient light without color
+    size_t nextCone = 0;       // first cone light without position/angle
+};
+
+// Number of values a command needs (unknown commands are ignored)
+static int requiredValues(char cmd) {
+    switch (cmd) {
+    case 'e': case 'u': case 'f': case 'a': case 'i': return 3;
+    case 'd': case 'p': case 'o': case 'r': case 't': case 'c': return 4;
+    default: return 0;
+    }
+}
+
+// Execute a single tokenized command from scene file
+// (the caller has checked that it has requiredValues(cmd) values)
+void handleCommand(const SceneLine& line, CameraBasis& camera, vector<Illumination*>& illuminators, 
+                   vector<Primitive*>& objects, Vec3& ambientLight, ParseCursors& cursors) {
+    const char cmd = line.command;
+    const float* values = line.values;
+
+    switch (cmd) {
+    case 'e':  // Eye position
+        camera.eye = glm::vec3(values[0], values[1], values[2]); 
+        if (line.count > 3) camera.focalLength = values[3]; 
+        break;
+    case 'u':  // Up vector
+        camera.up = glm::vec3(values[0], values[1], values[2]); 
+        if (line.count > 3) camera.viewportHeight = values[3]; 
+        break;
+    case 'f':  // Forward direction
+        camera.forward = glm::vec3(values[0], values[1], values[2]); 
+        // Implemented as stated in the PDF: use the scene's screen width from f ... w (4th value)
+        if (line.count > 3) camera.viewportWidth = values[3];
+        break;
+    case 'a':  // Ambient light color
+        ambientLight = Vec3(values[0], values[1], values[2]); 
+        break;
+    case 'd':  // Directional or cone light
+        if(values[3] == 0.0f) 
+            illuminators.push_back(new ParallelLight(glm::vec3(values[0], values[1], values[2])));
+        else 
+            illuminators.push_back(new ConeLight(glm::vec3(values[0], values[1], values[2])));
+        break;
+    case 'p':  // Cone light position and angle
+        // A cone keeps angle -1 until positioned (and stays pending if given -1)
+        while(cursors.nextCone < illuminators.size() &&
+              !(illuminators[cursors.nextCone]->isConeType() &&
+                static_cast<ConeLight*>(illuminators[cursors.nextCone])->getAngle() == -1.0f)) {
+            ++cursors.nextCone;
+        }
+        if(cursors.nextCone < illuminators.size()) {
+            auto* cone = static_cast<ConeLight*>(illuminators[cursors.nextCone]);
+            cone->setAngle(values[3]); 
+            cone->setPosition(glm::vec3(values[0], values[1], values[2])); 
+        }
+        break;
+    case 'i':  // Light intensity/color
+        while(cursors.nextIntensity < illuminators.size() &&
+              (illuminators[cursors.nextIntensity]->isGlobalType() ||
+               illuminators[cursors.nextIntensity]->isColorSet())) {
+            ++cursors.nextIntensity;
+        }
+        if(cursors.nextIntensity < illuminators.size()) {
+            illuminators[cursors.nextIntensity]->setColor(values[0], values[1], values[2]); 
+        }
+        break;
+    case 'o': case 'r': case 't':  // Object (standard/mirror/glass)
+        {
+            MaterialType matType = (cmd == 'o') ? STANDARD : (cmd == 'r') ? MIRROR : GLASS;
+            if(values[3] > 0) 
+                objects.push_back(new Sphere(glm::vec3(values[0], values[1], values[2]), values[3], matType));
+            else 
+                objects.push_back(new Plane(glm::vec3(values[0], values[1], values[2]), values[3], matType));
+        }
+        break;
+    case 'c':  // Color for object
+        while(cursors.nextColor < objects.size() && objects[cursors.nextColor]->is_rgb_set()) {
+            ++cursors.nextColor;
+        }
+        if(cursors.nextColor < objects.size()) {
+            objects[cursors.nextColor]->set_rgb(values[0], values[1], values[2], values[3]); 
+        }
+        break;
+    default: break;
+    }
+}
+
+// Parse a whole scene held in memory (tokenized in place)
+// Returns false (error names the offending line) if it is malformed.
+static bool parseScene(const char* begin, const char* end, const string& name, CameraBasis& camera,
+                       vector<Illumination*>& illuminators, vector<Primitive*>& objects, Vec3& ambientLight,
+                       string& error) {
+    SceneTokenizer tokenizer(begin, end);
+    SceneLine line;
+    ParseCursors cursors;
+    while (tokenizer.next(line)) {
+        int required = requiredValues(line.command);
+        if (line.count < required) {
+            error = name + ": line " + to_string(line.lineNumber) + ": '" + line.command + "' expects " +
+                    to_string(required) + " values, got " + to_string(line.count);
+            return false;
+        }
+        handleCommand(line, camera, illuminators, objects, ambientLight, cursors);
+    }
+    if (tokenizer.failed()) {
+        error = name + ": " + tokenizer.getError();
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// CAMERA/VIEWPORT SETUP
+// ============================================================================
+
+// Configure viewport coordinate system based on image dimensions
+// Implemented as stated in the PDF: only auto-compute width if it wasn't provided from 'f' command
+CameraBasis configureViewport(CameraBasis camera, int width, int height) {
+    camera.forward = glm::normalize(camera.forward);
+    camera.up = glm::normalize(camera.up);
+    camera.right = glm::normalize(glm::cross(camera.forward, camera.up));
+    float aspect = (float)width / height;
+    if (camera.viewportWidth == 0.0f) {
+        camera.viewportWidth = camera.viewportHeight * aspect;
+    }
+    camera.viewportCenter = camera.eye + (camera.forward * camera.focalLength);
+    return camera;
+}
+
+// Create ray from the context's camera through pixel at (px, py)
+RayCast generateRay(const RenderContext& context, int px, int py) {
+    const CameraBasis& camera = context.camera;
+    float u = (px + 0.5f) / context.width - 0.5f;   // Normalized x coordinate [-0.5, 0.5]
+    float v = 0.5f - (py + 0.5f) / context.height;  // Normalized y coordinate [-0.5, 0.5]
+    Vec3 pixelLocation = camera.viewportCenter + (camera.right * (u * camera.viewportWidth)) + (camera.up * (v * camera.viewportHeight));
+    Vec3 rayDirection = glm::normalize(pixelLocation - camera.eye);
+    return RayCast(camera.eye, rayDirection);
+}
+
+// ============================================================================
+// RAY-OBJECT INTERSECTION
+// ============================================================================
+
+// Find closest intersection with scene objects (BVH traversal, planes tested linearly)
+// Hits closer than 0.001 to the ray origin are self-intersections and are ignored
+static bool closestHit(const RayCast& ray, const BVH& bvh, HitResult& hit) {
+    if (!bvh.closestHit(ray, 0.001f, hit)) return false;
+    hit.resolve(ray);
+    return true;
+}
+
+// Check if point is occluded from light source (shadow test)
+// Any-hit query: stops at the first blocker. Parallel lights pass an infinite
+// lightDistance, for which the primitives use their unbounded fast path.
+bool isOccluded(const Vec3& pt, const Vec3& lightDirection, const float lightDistance, 
+                const BVH& bvh) {
+    // Ray starts 0.01 in front of pt, so the light is 0.01 closer to its origin
+    RayCast occlusionRay(pt + lightDirection * 0.01f, lightDirection); 
+    return bvh.isOccluded(occlusionRay, 0.0f, lightDistance - 0.01f);
+}
+
+// ============================================================================
+// SHADING AND COLOR
+// ============================================================================
+
+// Sample checkerboard pattern for planes
+Vec3 samplePattern(Vec3 baseColor, Vec3 pt, Vec3 n) {
+    const float tileSize = 0.5f;
+    float patternValue = 0;
+    
+    // Calculate pattern based on x and y coordinates
+    if (pt.x < 0) {
+        patternValue += floor((0.5 - pt.x) / tileSize);
+    } else {
+        patternValue += floor(pt.x / tileSize);
+    }
+    if (pt.y < 0) {
+        patternValue += floor((0.5 - pt.y) / tileSize);
+    } else {
+        patternValue += floor(pt.y / tileSize);
+    }
+    patternValue = (patternValue * 0.5) - int(patternValue * 0.5);
+    patternValue *= 2;
+
+    // Return darker or lighter based on pattern
+    return (patternValue > 0.5) ? (0.5f * baseColor) : baseColor;
+}
+
+// Get object color (with checkerboard pattern for planes)
+Vec3 sampleColor(const Surface* obj, const Vec3& pt) {
+    if (obj->is_plane()) {
+        return samplePattern(obj->get_rgb(), pt, obj->get_normal(pt));
+    }
+    return obj->get_rgb();
+}
+
+// Returns 1.0 for bright tiles and 0.5 for dark tiles (planes only)
+// Implemented as stated in the PDF: checkerboard affects diffuse only, not ambient
+float checkerCoeff(const Surface* obj, const Vec3& pt) {
+    if (!obj->is_plane()) return 1.0f;
+
+    const float tileSize = 0.5f;
+    float patternValue = 0;
+
+    if (pt.x < 0) patternValue += floor((0.5f - pt.x) / tileSize);
+    else          patternValue += floor(pt.x / tileSize);
+
+    if (pt.y < 0) patternValue += floor((0.5f - pt.y) / tileSize);
+    else          patternValue += floor(pt.y / tileSize);
+
+    patternValue = (patternValue * 0.5f) - int(patternValue * 0.5f);
+    patternValue *= 2.0f;
+
+    return (patternValue > 0.5f) ? 0.5f : 1.0f;
+}
+
+// Calculate Lambertian diffuse shading component
+// Implemented as stated in the PDF: checkerboard affects diffuse only
+glm::vec3 lambertianShading(const Surface* obj, const glm::vec3& pt, const LightSource& light, 
+                            const glm::vec3& lightDirection) {
+    glm::vec3 normal = glm::normalize(obj->get_normal(pt));
+    float nDotL = glm::max(glm::dot(normal, lightDirection), 0.0f);
+    Vec3 kd = obj->get_rgb() * checkerCoeff(obj, pt);
+    return kd * nDotL * light.color;
+}
+
+// Calculate Phong specular highlight component
+glm::vec3 phongHighlight(const Surface* obj, const glm::vec3& pt, const glm::vec3& eyePos, 
+                          const LightSource& light, const glm::vec3& lightDirection) {
+    glm::vec3 normal = glm::normalize(obj->get_normal(pt));
+    glm::vec3 viewDirection = glm::normalize(eyePos - pt);
+    glm::vec3 reflectionDirection = glm::normalize(glm::reflect(-lightDirection, normal));
+    float viewDotReflect = glm::max(glm::dot(viewDirection, reflectionDirection), 0.0f);
+    float specularPower = glm::pow(viewDotReflect, obj->get_shininess());
+    glm::vec3 specularColor(0.7f, 0.7f, 0.7f);
+    return specularColor * specularPower * light.color;
+}
+
+// Add the shadow ray from pt toward a light to batch (cast as isOccluded does)
+static void addShadowRay(ShadowBatch& batch, const Vec3& pt, const Vec3& lightDirection, float lightDistance) {
+    batch.add(RayCast(pt + lightDirection * 0.01f, lightDirection), lightDistance - 0.01f);
+}
+
+// Most recent occluder (a BVH occluder id) of each light's shadow rays, kept
+// by the thread tracing one tile. Neighbouring shading points are usually
+// shadowed by the same object, so it is tested before the BVH walk.
+struct OccluderCache {
+    vector<uint32_t> last;     // per light
+    vector<uint64_t> walked;   // per light: shadow rays tested with the BVH
+    uint64_t shadowRays = 0;
+    uint64_t lookups = 0;      // shadow rays whose light had a cached occluder
+    uint64_t hits = 0;         // ... that it blocked
+
+    explicit OccluderCache(size_t lightCount) : last(lightCount, BVH::NO_OCCLUDER), walked(lightCount, 0) {}
+};
+
+// Shadow test of batch, whose ray i goes toward light lightOf[i]. Rays toward
+// a light with a LightGrid (parallel lights) are answered by the grid. The
+// others share one BVH walk: the cached occluders are tried first, and the
+// cache keeps each ray's new occluder.
+static uint32_t testShadows(const ShadowBatch& batch, const int* lightOf, const SceneSnapshot& scene,
+                            OccluderCache& cache) {
+    uint32_t occluded = 0;
+    ShadowBatch walked;                    // rays left for the BVH
+    int walkedRay[ShadowBatch::SIZE];      // their index in batch
+    uint32_t occluders[ShadowBatch::SIZE];
+    for (int ray = 0; ray < batch.count; ++ray) {
+        ++cache.shadowRays;
+        const RayCast shadowRay(batch.origin(ray), batch.direction(ray));
+        if (const LightGrid* grid = scene.getLightGrid(lightOf[ray])) {
+            if (grid->isOccluded(shadowRay, 0.0f, batch.tmax[ray])) occluded |= 1u << ray;
+            continue;
+        }
+        ++cache.walked[lightOf[ray]];
+        occluders[walked.count] = cache.last[lightOf[ray]];
+        walkedRay[walked.count] = ray;
+        walked.add(shadowRay, batch.tmax[ray]);
+    }
+    if (walked.count == 0) return occluded;
+    const uint32_t walkedOccluded = scene.getBVH().occludedMask(walked, 0.0f, occluders);
+
+    for (int i = 0; i < walked.count; ++i) {
+        uint32_t& last = cache.last[lightOf[walkedRay[i]]];
+        const bool blocked = (walkedOccluded & (1u << i)) != 0;
+        if (last != BVH::NO_OCCLUDER) {
+            ++cache.lookups;
+            if (blocked && occluders[i] == last) ++cache.hits;
+        }
+        if (blocked) {
+            last = occluders[i];
+            occluded |= 1u << walkedRay[i];
+        }
+    }
+    return occluded;
+}
+
+// Calculate total illumination at point (ambient + diffuse + specular)
+// Implemented as stated in the PDF: ambient uses base color only (checkerboard does not affect ambient)
+// The shadow rays of up to ShadowBatch::SIZE lights are tested together (testShadows).
+Vec3 calculateIllumination(const HitResult& hit, const Vec3& eyePos, const SceneSnapshot& scene,
+                           OccluderCache& cache) {
+    const Surface* obj = hit.get_object();
+    const Vec3& pt = hit.get_point();
+    const ArrayView<LightSource> lights = scene.getLights();
+    Vec3 finalColor = obj->get_rgb() * scene.getAmbient(); 
+    for (size_t first = 0; first < lights.size(); first += ShadowBatch::SIZE) {
+        const size_t last = std::min(lights.size(), first + ShadowBatch::SIZE);
+        ShadowBatch batch;
+        int lightOf[ShadowBatch::SIZE];
+        for (size_t l = first; l < last; ++l) {
+            Vec3 lightDirection;
+            float lightDistance;
+            if (!calculateLightDirection(lights[l], pt, lightDirection, lightDistance)) continue;
+            lightOf[batch.count] = (int)l;
+            addShadowRay(batch, pt, lightDirection, lightDistance);
+        }
+        const uint32_t occluded = testShadows(batch, lightOf, scene, cache);
+
+        for (int ray = 0; ray < batch.count; ++ray) {
+            if (occluded & (1u << ray)) continue;
+            const LightSource& light = lights[lightOf[ray]];
+            const Vec3 lightDirection = batch.direction(ray);
+            finalColor += lambertianShading(obj, pt, light, lightDirection);
+            finalColor += phongHighlight(obj, pt, eyePos, light, lightDirection);
+        }
+    }
+    return finalColor;
+}
+
+// ============================================================================
+// RAY TRACING
+// ============================================================================
+
+// Ray waiting to be traced: the color it finds is added to the pixel scaled by weight
+struct PendingRay {
+    Vec3 origin;
+    Vec3 direction;
+    Vec3 weight;
+    int depth;      // bounces before this ray (0 for primary rays)
+};
+
+// Fixed-capacity LIFO of pending rays, kept on the tracing thread's stack.
+// Mirrors and glass continue a path with one ray, so a path needs one slot;
+// the spare slots leave room for surfaces that split a ray.
+const int RAY_STACK_CAPACITY = 16;
+
+class RayStack {
+public:
+    bool empty() const { return count == 0; }
+
+    // A ray that does not fit is dropped (it adds black)
+    void push(const Vec3& origin, const Vec3& direction, const Vec3& weight, int depth) {
+        if (count < RAY_STACK_CAPACITY) rays[count++] = PendingRay{origin, direction, weight, depth};
+    }
+
+    PendingRay pop() { return rays[--count]; }
+
+private:
+    PendingRay rays[RAY_STACK_CAPACITY];
+    int count = 0;
+};
+
+// Reflection: the ray continuing a path from a mirror hit
+static void reflectRay(const HitResult& hit, const Vec3& rayDirection, Vec3& nextOrigin, Vec3& nextDirection) {
+    nextDirection = glm::reflect(rayDirection, hit.get_normal());
+    nextOrigin = hit.get_point() + nextDirection * 0.001f;
+}
+
+// Refraction: follow the ray through the glass object; the ray continuing the
+// path leaves from the exit point (false if the inner ray misses the object)
+static bool refractRay(const HitResult& hit, const Vec3& rayDirection, Vec3& nextOrigin, Vec3& nextDirection) {
+    const Surface* obj = hit.get_object();
+    const Vec3& normal = hit.get_normal();
+
+    // Entering: Air (n1=1.0) to Glass (n2=1.5)
+    const float n1 = 1.0f, n2 = 1.5f;
+    Vec3 refractedIn = glm::refract(rayDirection, normal, n1 / n2);
+
+    // Total internal reflection: use reflection instead
+    if (glm::length(refractedIn) < 0.01f) {
+        refractedIn = glm::reflect(rayDirection, normal);
+    }
+
+    // Find exit point by tracing through object
+    RayCast internalRay(hit.get_point() + refractedIn * 0.01f, refractedIn);
+    HitResult exit;
+    if (!obj->intersect(internalRay, 0.0f, exit)) return false;
+
+    // Exiting: Glass (n2=1.5) to Air (n1=1.0)
+    exit.resolve(internalRay);
+    Vec3 refractedOut = glm::refract(refractedIn, -exit.get_normal(), n2 / n1);
+    if (glm::length(refractedOut) < 0.01f) refractedOut = refractedIn;
+
+    nextDirection = refractedOut;
+    nextOrigin = exit.get_point() + refractedOut * 0.01f;
+    return true;
+}
+
+// Color a hit adds itself (before the incoming weight); mirrors and glass add
+// none and push the rays that continue the path instead
+static Vec3 scatter(const HitResult& hit, const PendingRay& incoming, const RenderContext& context,
+                    RayStack& stack, OccluderCache& cache) {
+    Vec3 origin, direction;
+    if (hit.get_object()->is_reflective()) {
+        reflectRay(hit, incoming.direction, origin, direction);
+        stack.push(origin, direction, incoming.weight, incoming.depth + 1);
+        return Vec3(0, 0, 0);
+    }
+    if (hit.get_object()->is_transparent()) {
+        // Implemented as stated in the PDF: transparent objects use refracted color only (ignore material lighting)
+        if (refractRay(hit, incoming.direction, origin, direction)) {
+            stack.push(origin, direction, incoming.weight, incoming.depth + 1);
+        }
+        return Vec3(0, 0, 0);
+    }
+
+    // Standard material: calculate lighting
+    return calculateIllumination(hit, incoming.origin, context.scene, cache);
+}
+
+// Trace every pending ray (and the rays they spawn) and sum their weighted
+// colors. Rays deeper than context.maxDepth and rays that hit nothing add black.
+static Vec3 integrate(RayStack& stack, const RenderContext& context, OccluderCache& cache) {
+    Vec3 color(0, 0, 0);
+    while (!stack.empty()) {
+        const PendingRay pending = stack.pop();
+        if (pending.depth > context.maxDepth) continue;
+
+        HitResult hit;
+        if (!closestHit(RayCast(pending.origin, pending.direction), context.scene.getBVH(), hit)) continue;
+        color += pending.weight * scatter(hit, pending, context, stack, cache);
+    }
+    return color;
+}
+
+// Calculate color of a resolved primary hit (secondary rays are traced one by one)
+static Vec3 shadeHit(const HitResult& hit, const RayCast& ray, const RenderContext& context, OccluderCache& cache) {
+    RayStack stack;
+    const PendingRay primary{ray.getOrigin(), ray.getDirection(), Vec3(1.0f), 0};
+    const Vec3 color = scatter(hit, primary, context, stack, cache);
+    return color + integrate(stack, context, cache);
+}
+
+// Trace a primary ray through the scene and calculate its color
+Vec3 traceRay(const RayCast& ray, const RenderContext& context, OccluderCache& cache) {
+    RayStack stack;
+    stack.push(ray.getOrigin(), ray.getDirection(), Vec3(1.0f), 0);
+    return integrate(stack, context, cache);
+}
+
+// ============================================================================
+// WAVEFRONT
+// ============================================================================
+
+// Wavefront mode traces a tile one wave of rays at a time instead of one path
+// at a time: every ray of the wave is intersected, the hits are sorted into
+// STANDARD/MIRROR/GLASS queues, the STANDARD queue is shaded in one loop whose
+// shadow rays are tested in one batched pass, and the MIRROR and GLASS queues emit
+// the rays of the next wave. Colors are summed in traceRay's order, so the
+// pixels are identical.
+
+// Ray of a wave, continuing the path of tile pixel `pixel`
+struct WaveRay {
+    Vec3 origin;
+    Vec3 direction;
+    Vec3 weight;
+    int pixel;
+};
+
+// Shadow ray from STANDARD hit `hit` of the wave toward light `light`
+struct ShadowRay {
+    int hit;
+    int light;
+    Vec3 direction;
+    float distance;
+    bool occluded;
+};
+
+// Per-tile buffers, reused from wave to wave
+struct Wavefront {
+    vector<WaveRay> rays;
+    vector<WaveRay> next;
+    vector<HitResult> hits;
+    vector<int> standard;
+    vector<int> mirror;
+    vector<int> glass;
+    vector<ShadowRay> shadows;
+    vector<Vec3> shaded;
+};
+
+// Trace one wave: add the STANDARD hits' colors to pixels and leave the rays
+// of the next wave in wave.next
+static void traceWave(Wavefront& wave, const RenderContext& context, vector<Vec3>& pixels, OccluderCache& cache) {
+    const SceneSnapshot& scene = context.scene;
+    const ArrayView<LightSource> lights = scene.getLights();
+
+    // 1. Intersect every ray and queue the hits by material
+    wave.hits.assign(wave.rays.size(), HitResult());
+    wave.standard.clear();
+    wave.mirror.clear();
+    wave.glass.clear();
+    for (size_t i = 0; i < wave.rays.size(); ++i) {
+        if (!closestHit(RayCast(wave.rays[i].origin, wave.rays[i].direction), scene.getBVH(), wave.hits[i])) continue;
+        const Surface* obj = wave.hits[i].get_object();
+        (obj->is_reflective() ? wave.mirror : obj->is_transparent() ? wave.glass : wave.standard).push_back((int)i);
+    }
+
+    // 2. STANDARD: ambient term, and a shadow ray for every light that can reach the hit
+    wave.shaded.resize(wave.rays.size());
+    wave.shadows.clear();
+    for (int i : wave.standard) {
+        const HitResult& hit = wave.hits[i];
+        wave.shaded[i] = hit.get_object()->get_rgb() * scene.getAmbient();
+        for (size_t l = 0; l < lights.size(); ++l) {
+            ShadowRay shadow{i, (int)l, Vec3(0.0f), 0.0f, false};
+            if (calculateLightDirection(lights[l], hit.get_point(), shadow.direction, shadow.distance)) {
+                wave.shadows.push_back(shadow);
+            }
+        }
+    }
+
+    // 3. Shadow rays: the lights of each hit are tested together (up to ShadowBatch::SIZE at a time)
+    for (size_t first = 0; first < wave.shadows.size();) {
+        const int hit = wave.shadows[first].hit;
+        ShadowBatch batch;
+        int lightOf[ShadowBatch::SIZE];
+        size_t last = first;
+        while (last < wave.shadows.size() && wave.shadows[last].hit == hit && batch.count < ShadowBatch::SIZE) {
+            lightOf[batch.count] = wave.shadows[last].light;
+            addShadowRay(batch, wave.hits[hit].get_point(), wave.shadows[last].direction, wave.shadows[last].distance);
+            ++last;
+        }
+        const uint32_t occluded = testShadows(batch, lightOf, scene, cache);
+        for (size_t i = first; i < last; ++i) wave.shadows[i].occluded = (occluded & (1u << (i - first))) != 0;
+        first = last;
+    }
+
+    // 4. Lights that reach their hit, in light order (as calculateIllumination)
+    for (const ShadowRay& shadow : wave.shadows) {
+        if (shadow.occluded) continue;
+        const HitResult& hit = wave.hits[shadow.hit];
+        const LightSource& light = lights[shadow.light];
+        wave.shaded[shadow.hit] += lambertianShading(hit.get_object(), hit.get_point(), light, shadow.direction);
+        wave.shaded[shadow.hit] += phongHighlight(hit.get_object(), hit.get_point(), wave.rays[shadow.hit].origin,
+                                                  light, shadow.direction);
+    }
+    for (int i : wave.standard) pixels[wave.rays[i].pixel] += wave.rays[i].weight * wave.shaded[i];
+
+    // 5. MIRROR and GLASS: the rays continuing their paths form the next wave
+    wave.next.clear();
+    for (int i : wave.mirror) {
+        WaveRay next = wave.rays[i];
+        reflectRay(wave.hits[i], wave.rays[i].direction, next.origin, next.direction);
+        wave.next.push_back(next);
+    }
+    for (int i : wave.glass) {
+        WaveRay next = wave.rays[i];
+        if (refractRay(wave.hits[i], wave.rays[i].direction, next.origin, next.direction)) wave.next.push_back(next);
+    }
+}
+
+// ============================================================================
+// RENDERING
+// ============================================================================
+
+// Edge length (in pixels) of the square tiles handed out to render threads
+// (a multiple of RayPacket::DIM, so packets never straddle tiles)
+const int TILE_SIZE = 32;
+
+// Destination of a render: image holds the frame's pixels from (originX, originY)
+// on (the whole frame, or one region of it)
+struct RenderTarget {
+    ImageBuffer& image;
+    int originX;
+    int originY;
+};
+
+// Store clamped 8-bit color of frame pixel (x, y) in the target buffer (and the
+// unclamped color if the buffer keeps it)
+static void storePixel(int x, int y, Vec3 color, const RenderTarget& target) {
+    ImageBuffer& image = target.image;
+    size_t pixelIdx = 3 * ((size_t)(y - target.originY) * image.width + (x - target.originX));
+    if (!image.radiance.empty()) {
+        image.radiance[pixelIdx]     = color.x;
+        image.radiance[pixelIdx + 1] = color.y;
+        image.radiance[pixelIdx + 2] = color.z;
+    }
+
+    color = glm::clamp(color, Vec3(0.0f), Vec3(1.0f));
+    image.rgb[pixelIdx]     = (unsigned char)(255 * color.x);
+    image.rgb[pixelIdx + 1] = (unsigned char)(255 * color.y);
+    image.rgb[pixelIdx + 2] = (unsigned char)(255 * color.z);
+}
+
+// Trace one pixel and store its color in the image buffer
+static void renderPixel(int x, int y, const RenderContext& context, const RenderTarget& target,
+                        OccluderCache& cache) {
+    RayCast ray = generateRay(context, x, y);
+    Vec3 color = traceRay(ray, context, cache);
+    storePixel(x, y, color, target);
+}
+
+// Trace tile [x0, x1) x [y0, y1) in RayPacket::DIM x DIM blocks: the primary hits
+// of a block come from one packet traversal, shading then continues per pixel
+// (reflection and refraction rays are traced singly)
+static void renderTilePackets(int x0, int y0, int x1, int y1, const RenderContext& context,
+                              const RenderTarget& target, OccluderCache& cache) {
+    const int dim = RayPacket::DIM;
+    for (int by = y0; by < y1; by += dim) {
+        for (int bx = x0; bx < x1; bx += dim) {
+            RayPacket packet;
+            for (int ly = 0; ly < dim; ++ly) {
+                for (int lx = 0; lx < dim; ++lx) {
+                    if (bx + lx >= x1 || by + ly >= y1) continue;
+                    packet.setRay(ly * dim + lx, generateRay(context, bx + lx, by + ly));
+                }
+            }
+
+            PacketHit hits;
+            hits.reset(std::numeric_limits<float>::infinity());
+            context.scene.getBVH().closestHitPacket(packet, 0.001f, hits);
+
+            for (int lane = 0; lane < RayPacket::SIZE; ++lane) {
+                if (!(packet.activeMask & (1 << lane))) continue;
+                Vec3 color(0, 0, 0);
+                if (hits.prim[lane]) {
+                    RayCast ray(packet.origin, packet.direction(lane));
+                    HitResult hit;
+                    hit.record(hits.t[lane], hits.prim[lane]);
+                    hit.resolve(ray);
+                    color = shadeHit(hit, ray, context, cache);
+                }
+                storePixel(bx + lane % dim, by + lane / dim, color, target);
+            }
+        }
+    }
+}
+
+// Trace tile [x0, x1) x [y0, y1) in waves: first all camera rays, then each
+// generation of reflection/refraction rays (up to context.maxDepth)
+static void renderTileWavefront(int x0, int y0, int x1, int y1, const RenderContext& context,
+                                const RenderTarget& target, OccluderCache& cache) {
+    const int tileWidth = x1 - x0;
+    vector<Vec3> pixels((size_t)tileWidth * (y1 - y0), Vec3(0.0f));
+    Wavefront wave;
+    wave.rays.reserve(pixels.size());
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            RayCast ray = generateRay(context, x, y);
+            wave.rays.push_back(WaveRay{ray.getOrigin(), ray.getDirection(), Vec3(1.0f), (y - y0) * tileWidth + (x - x0)});
+        }
+    }
+
+    for (int depth = 0; depth <= context.maxDepth && !wave.rays.empty(); ++depth) {
+        traceWave(wave, context, pixels, cache);
+        wave.rays.swap(wave.next);
+    }
+
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        storePixel(x0 + (int)i % tileWidth, y0 + (int)i / tileWidth, pixels[i], target);
+    }
+}
+
+// Render a region of the frame to image buffer
+// The region is split into TILE_SIZE tiles that the pool's threads take (and steal) in parallel.
+// Each tile has its own occluder cache, so threads share no mutable state.
+// Every pixel is written by exactly one tile, so the result matches a serial render.
+// Threads only read the render context.
+void renderRegion(const RenderContext& context, int regionX, int regionY, ImageBuffer& region, ThreadPool& pool) {
+    const RenderTarget target{region, regionX, regionY};
+    const int tilesX = (region.width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesY = (region.height + TILE_SIZE - 1) / TILE_SIZE;
+
+    pool.parallelFor(tilesX * tilesY, [&](int tile) {
+        const int x0 = regionX + (tile % tilesX) * TILE_SIZE;
+        const int y0 = regionY + (tile / tilesX) * TILE_SIZE;
+        const int x1 = std::min(x0 + TILE_SIZE, regionX + region.width);
+        const int y1 = std::min(y0 + TILE_SIZE, regionY + region.height);
+        OccluderCache cache(context.scene.getLights().size());
+        if (context.wavefront) {
+            renderTileWavefront(x0, y0, x1, y1, context, target, cache);
+        } else if (context.packetTracing) {
+            renderTilePackets(x0, y0, x1, y1, context, target, cache);
+        } else {
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    renderPixel(x, y, context, target, cache);
+                }
+            }
+        }
+        // The BVH rays may pay for light grids that later tiles use
+        for (size_t l = 0; l < cache.walked.size(); ++l) {
+            if (cache.walked[l] > 0) context.scene.countShadowRays(l, cache.walked[l]);
+        }
+        if (context.stats) {
+            context.stats->shadowRays += cache.shadowRays;
+            context.stats->occluderLookups += cache.lookups;
+            context.stats->occluderHits += cache.hits;
+        }
+    });
+}
+
+void renderImage(const RenderContext& context, ImageBuffer& image, ThreadPool& pool) {
+    renderRegion(context, 0, 0, image, pool);
+}
+
+// Two queues form the ring: free buffers go to the renderer, rendered bands to
+// the sink thread, which returns each buffer once the sink is done with it
+bool renderBands(const RenderContext& context, int bandRows, bool keepRadiance, ThreadPool& pool,
+                 const std::function<bool(const ImageBuffer&)>& sink) {
+    bandRows = std::max(1, std::min(bandRows, context.height));
+    BoundedQueue<std::unique_ptr<ImageBuffer>> spare(BAND_RING);
+    BoundedQueue<std::unique_ptr<ImageBuffer>> rendered(BAND_RING);
+    for (int i = 0; i < BAND_RING; ++i) spare.push(std::unique_ptr<ImageBuffer>());
+    std::atomic<bool> failed{false};
+
+    std::thread consumer([&] {
+        std::unique_ptr<ImageBuffer> band;
+        while (rendered.pop(band)) {
+            if (!failed && !sink(*band)) failed = true;
+            spare.push(std::move(band));
+        }
+    });
+
+    for (int y0 = 0; y0 < context.height && !failed; y0 += bandRows) {
+        const int rows = std::min(bandRows, context.height - y0);
+        std::unique_ptr<ImageBuffer> band;
+        spare.pop(band);
+        if (!band || band->height != rows) band.reset(new ImageBuffer(context.width, rows, keepRadiance));
+        renderRegion(context, 0, y0, *band, pool);
+        rendered.push(std::move(band));
+    }
+    rendered.close();
+    consumer.join();
+    return !failed;
+}
+
+// Parse scene text and compile it
+SceneSnapshot* compileSceneText(const char* text, size_t length, const string& name, string& error) {
+    CameraBasis camera = defaultCamera();
+    vector<Illumination*> illuminators;
+    vector<Primitive*> objects;
+    Vec3 ambientLight(0.0f, 0.0f, 0.0f);
+
+    // Compile the render-ready snapshot; the parsed objects are no longer needed
+    SceneSnapshot* scene = nullptr;
+    if (parseScene(text, text + length, name, camera, illuminators, objects, ambientLight, error)) {
+        try {
+            scene = new SceneSnapshot(objects, illuminators, ambientLight, camera);
+        } catch (const std::invalid_argument& e) {
+            error = "Invalid scene " + name + ": " + e.what();
+        }
+    }
+    for (Illumination* illum : illuminators) delete illum;
+    for (Primitive* obj : objects) delete obj;
+    return scene;
+}
+
+// Read a text scene file into one buffer and compile it
+static SceneSnapshot* compileScene(const string& filepath, string& error) {
+    ifstream file(filepath, ios::binary | ios::ate);
+    streamoff size = file.is_open() ? (streamoff)file.tellg() : -1;
+    vector<char> buffer(size > 0 ? (size_t)size : 0);
+    if (size < 0 || !file.seekg(0) || !file.read(buffer.data(), buffer.size())) {
+        error = "Failed to open: " + filepath;
+        return nullptr;
+    }
+    return compileSceneText(buffer.data(), buffer.size(), filepath, error);
+}
+
+// Whether path names a compiled .rtsb scene
+static bool isBinaryScene(const string& filepath) {
+    const string extension = ".rtsb";
+    return filepath.size() >= extension.size() &&
+           filepath.compare(filepath.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+SceneSnapshot* loadScene(const string& filepath, string& error) {
+    if (!isBinaryScene(filepath)) return compileScene(filepath, error);
+    SceneSnapshot* scene = SceneSnapshot::load(filepath, error);
+    if (!scene) error = "Failed to load " + filepath + ": " + error;
+    return scene;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "SceneSnapshot.h"
+#include "ImageWriter.h"
+#include "ThreadPool.h"
+
+// Rendering engine shared by raytracer.exe and libraytracer (RayTracerApi.cpp).
+// There is no global state: a scene is parsed into its own CameraBasis and
+// compiled into a SceneSnapshot, and a render reads only its RenderContext.
+// Any number of scenes can therefore be loaded and rendered at the same time.
+
+// Camera view as given by a scene, configured for a width x height image:
+// directions normalized, right and viewportCenter set, and the viewport width
+// derived from the aspect ratio if the scene did not give one
+CameraBasis configureViewport(CameraBasis camera, int width, int height);
+
+// Reflection/refraction bounces traced after the primary hit, unless a render says otherwise
+const int DEFAULT_MAX_DEPTH = 5;
+
+// Counters a render adds to when RenderContext::stats is set
+struct RenderStats {
+    std::atomic<uint64_t> shadowRays{0};
+    std::atomic<uint64_t> occluderLookups{0};  // shadow rays whose light had a cached last occluder
+    std::atomic<uint64_t> occluderHits{0};     // ... that blocked them without a BVH walk
+};
+
+// Everything one render reads: the compiled scene, the camera configured for
+// the image size, and the options
+struct RenderContext {
+    const SceneSnapshot& scene;
+    CameraBasis camera;
+    int width;
+    int height;
+    bool packetTracing;           // trace primary rays in RayPacket::DIM^2 packets
+    int maxDepth;                 // bounces traced after the primary hit (deeper rays add black)
+    bool wavefront;               // trace each tile in waves sorted by material (overrides packetTracing)
+    RenderStats* stats = nullptr; // counters to add to, if any
+
+    RenderContext(const SceneSnapshot& scene, const CameraBasis& view, int width, int height, bool packetTracing,
+                  int maxDepth = DEFAULT_MAX_DEPTH, bool wavefront = false)
+        : scene(scene), camera(configureViewport(view, width, height)),
+          width(width), height(height), packetTracing(packetTracing), maxDepth(maxDepth), wavefront(wavefront) {}
+};
+
+// Render the scene into image (width x height as in the context) on the pool's threads
+void renderImage(const RenderContext& context, ImageBuffer& image, ThreadPool& pool);
+
+// Render the frame pixels [x0, x0 + region.width) x [y0, y0 + region.height)
+// into region, whose pixel (0, 0) is frame pixel (x0, y0); the region must lie
+// inside the frame. Gives the same pixels as renderImage.
+void renderRegion(const RenderContext& context, int x0, int y0, ImageBuffer& region, ThreadPool& pool);
+
+// Render the frame top to bottom in bands of bandRows full-width rows (the last
+// band may be shorter) and hand each band to sink, in order, on a separate
+// thread while the next band renders. Bands cycle through a ring of
+// BAND_RING buffers, so memory is a few bands whatever the image height.
+// keepRadiance fills ImageBuffer::radiance. Stops and returns false as soon
+// as sink returns false.
+const int BAND_RING = 3;
+bool renderBands(const RenderContext& context, int bandRows, bool keepRadiance, ThreadPool& pool,
+                 const std::function<bool(const ImageBuffer&)>& sink);
+
+// Parse scene text [text, text + length) and compile it. Returns nullptr and
+// sets error (prefixed with name) if it is malformed or degenerate.
+SceneSnapshot* compileSceneText(const char* text, size_t length, const std::string& name, std::string& error);
+
+// Load a scene file: .rtsb files are mapped and used in place, text scenes
+// are parsed and compiled. Returns nullptr and sets error on failure.
+SceneSnapshot* loadScene(const std::string& filepath, std::string& error);
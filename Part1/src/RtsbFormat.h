@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "SceneSnapshot.h"
+
+// .rtsb: a compiled SceneSnapshot written as-is, so that it can be memory-mapped
+// and rendered in place (see SceneSnapshot::load and SceneSnapshot::save).
+//
+// Layout: RtsbHeader, then these sections, each starting at a multiple of
+// RTSB_ALIGNMENT bytes from the start of the file:
+//   surfaces       surfaceCount x Surface          (scene order)
+//   lights         lightCount x LightSource        (scene order)
+//   nodes          nodeCount x BVH::Node
+//   sphereOrder    sphereCount x uint32            (BVH lane -> surface index)
+//   planes         planeCount x uint32             (surface indices)
+//   sphereLayout   SphereBlock::layoutSize(sphereCount) x float
+//
+// Records are stored in the writer's native layout. The header stores the byte
+// order and every record size, and a reader rejects a file that does not match.
+// Any change to a record or to the section list must bump RTSB_VERSION.
+
+static const char RTSB_MAGIC[4] = {'R', 'T', 'S', 'B'};
+static const uint32_t RTSB_VERSION = 1;
+static const uint32_t RTSB_BYTE_ORDER = 0x01020304;
+static const uint64_t RTSB_ALIGNMENT = 64;
+
+struct RtsbHeader {
+    char magic[4];              // RTSB_MAGIC
+    uint32_t version;           // RTSB_VERSION
+    uint32_t byteOrder;         // RTSB_BYTE_ORDER as written by the producer
+    uint32_t headerSize;        // sizeof(RtsbHeader)
+    uint32_t surfaceSize;       // sizeof(Surface)
+    uint32_t lightSize;         // sizeof(LightSource)
+    uint32_t nodeSize;          // sizeof(BVH::Node)
+    uint32_t cameraSize;        // sizeof(CameraBasis)
+
+    uint32_t surfaceCount;
+    uint32_t lightCount;
+    uint32_t nodeCount;
+    uint32_t sphereCount;
+    uint32_t planeCount;
+    uint32_t reserved;
+
+    uint64_t fileSize;          // total size, including the padding after the last section
+    uint64_t surfacesOffset;
+    uint64_t lightsOffset;
+    uint64_t nodesOffset;
+    uint64_t sphereOrderOffset;
+    uint64_t planesOffset;
+    uint64_t sphereLayoutOffset;
+
+    float ambient[3];           // ambient light color
+    CameraBasis camera;         // the scene's e/u/f camera (viewportWidth 0: from the
+                                // image aspect ratio); right and viewportCenter are
+                                // written as zero and recomputed per render by
+                                // configureViewport
+};
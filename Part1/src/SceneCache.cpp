@@ -0,0 +1,70 @@
+#include "SceneCache.h"
+
+#include <sys/stat.h>
+
+#include "Renderer.h"
+
+// Size and modification time of path; false if it does not exist
+static bool fileVersion(const std::string& path, long long& size, long long& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    size = (long long)info.st_size;
+    modified = (long long)info.st_mtime;
+    return true;
+}
+
+std::shared_ptr<const SceneSnapshot> SceneCache::get(const std::string& path, std::string& error, bool& hit) {
+    long long size = 0, modified = 0;
+    if (!fileVersion(path, size, modified)) {
+        error = "Failed to open: " + path;
+        hit = false;
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = entries.find(path);
+        if (found != entries.end() && found->second.fileSize == size && found->second.modified == modified) {
+            recentPaths.splice(recentPaths.begin(), recentPaths, found->second.recent);
+            ++hits;
+            hit = true;
+            return found->second.scene;
+        }
+        ++misses;
+    }
+
+    // Load without holding the lock: other scenes stay available meanwhile
+    // (two threads missing on the same path both load it, the last one is kept)
+    hit = false;
+    std::shared_ptr<const SceneSnapshot> scene(loadScene(path, error));
+    if (!scene) return nullptr;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = entries.find(path);
+    if (found != entries.end()) {
+        recentPaths.erase(found->second.recent);
+        entries.erase(found);
+    }
+    while (entries.size() >= capacity) {
+        entries.erase(recentPaths.back());
+        recentPaths.pop_back();
+    }
+    recentPaths.push_front(path);
+    entries[path] = Entry{scene, size, modified, recentPaths.begin()};
+    return scene;
+}
+
+size_t SceneCache::size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return entries.size();
+}
+
+unsigned long long SceneCache::getHits() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
+
+unsigned long long SceneCache::getMisses() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return misses;
+}
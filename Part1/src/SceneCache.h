@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "SceneSnapshot.h"
+
+// Least-recently-used cache of compiled scenes, keyed by file path.
+// An entry is reused while the file's size and modification time are
+// unchanged, so edited scene files are picked up on their next use.
+// Snapshots are shared: an entry evicted while a render still holds it stays
+// alive until that render ends. Safe to use from several threads.
+class SceneCache {
+public:
+    explicit SceneCache(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    // Compiled scene for path, loaded (see loadScene) on a miss. Returns
+    // nullptr and sets error if it cannot be loaded; hit tells whether the
+    // scene came from the cache.
+    std::shared_ptr<const SceneSnapshot> get(const std::string& path, std::string& error, bool& hit);
+
+    size_t size() const;
+    size_t getCapacity() const { return capacity; }
+    unsigned long long getHits() const;
+    unsigned long long getMisses() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const SceneSnapshot> scene;
+        long long fileSize;
+        long long modified;
+        std::list<std::string>::iterator recent;  // position in recentPaths
+    };
+
+    const size_t capacity;
+    std::list<std::string> recentPaths;           // most recently used first
+    std::unordered_map<std::string, Entry> entries;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    mutable std::mutex lock;
+};
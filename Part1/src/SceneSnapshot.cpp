@@ -0,0 +1,241 @@
+#include "SceneSnapshot.h"
+#include "Sphere.h"
+#include "Plane.h"
+#include "ConeLight.h"
+#include "RtsbFormat.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+// Compile one primitive: copy material, precompute the geometry invariants
+static Surface compileSurface(const Primitive& obj) {
+    Surface surface;
+    std::memset(&surface, 0, sizeof(surface));  // padding is written to .rtsb files
+    surface.kind = obj.get_kind();
+    surface.material = obj.get_material();
+    surface.shininess = obj.get_shininess();
+    surface.color = obj.get_rgb();
+    if (obj.is_plane()) {
+        const Plane& plane = static_cast<const Plane&>(obj);
+        surface.point = plane.point_on_plane();
+        surface.normal = plane.get_plane_normal();
+        surface.shadingNormal = glm::normalize(-surface.normal);
+    } else {
+        const Sphere& sphere = static_cast<const Sphere&>(obj);
+        surface.point = sphere.get_center();
+        surface.radius = sphere.get_radius();
+        surface.radiusSq = surface.radius * surface.radius;
+    }
+    return surface;
+}
+
+static std::vector<Surface> compileSurfaces(const std::vector<Primitive*>& objects) {
+    std::vector<Surface> surfaces;
+    surfaces.reserve(objects.size());
+    for (const Primitive* obj : objects) surfaces.push_back(compileSurface(*obj));
+    return surfaces;
+}
+
+// Compile parallel and cone lights; ambient (global) lights never cast light here
+static std::vector<LightSource> compileLights(const std::vector<Illumination*>& illuminators) {
+    std::vector<LightSource> lights;
+    for (const Illumination* illum : illuminators) {
+        if (illum->isGlobalType()) continue;
+        LightSource light;
+        std::memset(&light, 0, sizeof(light));
+        light.kind = illum->getKind();
+        light.color = illum->getColor();
+        if (illum->isConeType()) {
+            const ConeLight* cone = static_cast<const ConeLight*>(illum);
+            light.direction = glm::normalize(cone->getDirection());
+            light.position = cone->getPosition();
+            light.cosCutoff = cone->getAngle();
+        } else {
+            light.direction = glm::normalize(-illum->getDirection());
+        }
+        lights.push_back(light);
+    }
+    return lights;
+}
+
+// Constructor: compile, then build the BVH over the compiled surfaces
+SceneSnapshot::SceneSnapshot(const std::vector<Primitive*>& objects,
+                             const std::vector<Illumination*>& illuminators,
+                             const Vec3& ambientLight, const CameraBasis& view)
+    : ownedSurfaces(compileSurfaces(objects)),
+      ownedLights(compileLights(illuminators)),
+      ambient(ambientLight),
+      camera(view) {
+    surfaces = {ownedSurfaces.data(), ownedSurfaces.size()};
+    lights = {ownedLights.data(), ownedLights.size()};
+    bvh.reset(new BVH(surfaces.data(), (int)surfaces.size()));
+    lightGrids.reset(new LightGridSlot[lights.size()]);
+}
+
+// A grid build costs about as much as GRID_RAYS_PER_SPHERE BVH shadow queries
+// per sphere, so it is built once the light has traced that many; with fewer
+// than MIN_GRID_SPHERES spheres the BVH is a few leaves and a grid saves nothing
+static const uint64_t GRID_RAYS_PER_SPHERE = 4;
+static const int MIN_GRID_SPHERES = 16;
+
+// Counting and building change no rendering result, so they are allowed on a
+// const (shared) snapshot: the counter is atomic and one thread builds
+void SceneSnapshot::countShadowRays(size_t i, uint64_t count) const {
+    const LightSource& light = lights[i];
+    const int sphereCount = bvh->getArrays().sphereCount;
+    if (light.isConeType() || sphereCount < MIN_GRID_SPHERES) return;
+
+    LightGridSlot& slot = lightGrids[i];
+    if (slot.shadowRays.fetch_add(count) + count < GRID_RAYS_PER_SPHERE * (uint64_t)sphereCount) return;
+    if (slot.building.exchange(true)) return;
+    slot.grid.reset(new LightGrid(surfaces.data(), (int)surfaces.size(), light.direction));
+    if (slot.grid->isUsable()) slot.ready.store(slot.grid.get(), std::memory_order_release);
+}
+
+// ============================================================================
+// .rtsb FILES
+// ============================================================================
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + RTSB_ALIGNMENT - 1) / RTSB_ALIGNMENT * RTSB_ALIGNMENT;
+}
+
+// Section [offset, offset + count * itemSize) is aligned and inside the file
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t itemSize, uint64_t fileSize) {
+    return offset % RTSB_ALIGNMENT == 0 && offset <= fileSize && count * itemSize <= fileSize - offset;
+}
+
+bool SceneSnapshot::save(const std::string& path) const {
+    const BVH::Arrays& arrays = bvh->getArrays();
+
+    RtsbHeader header;
+    std::memset(static_cast<void*>(&header), 0, sizeof(header));  // padding bytes too
+    std::memcpy(header.magic, RTSB_MAGIC, sizeof(header.magic));
+    header.version = RTSB_VERSION;
+    header.byteOrder = RTSB_BYTE_ORDER;
+    header.headerSize = sizeof(RtsbHeader);
+    header.surfaceSize = sizeof(Surface);
+    header.lightSize = sizeof(LightSource);
+    header.nodeSize = sizeof(BVH::Node);
+    header.cameraSize = sizeof(CameraBasis);
+    header.surfaceCount = (uint32_t)surfaces.size();
+    header.lightCount = (uint32_t)lights.size();
+    header.nodeCount = (uint32_t)arrays.nodeCount;
+    header.sphereCount = (uint32_t)arrays.sphereCount;
+    header.planeCount = (uint32_t)arrays.planeCount;
+    header.ambient[0] = ambient.x;
+    header.ambient[1] = ambient.y;
+    header.ambient[2] = ambient.z;
+    header.camera = camera;
+    header.camera.right = header.camera.viewportCenter = Vec3(0.0f);  // derived per render
+
+    // Sections in file order
+    struct Section { const void* data; uint64_t bytes; uint64_t* offset; };
+    const Section sections[] = {
+        {surfaces.data(), surfaces.size() * sizeof(Surface), &header.surfacesOffset},
+        {lights.data(), lights.size() * sizeof(LightSource), &header.lightsOffset},
+        {arrays.nodes, (uint64_t)arrays.nodeCount * sizeof(BVH::Node), &header.nodesOffset},
+        {arrays.sphereOrder, (uint64_t)arrays.sphereCount * sizeof(uint32_t), &header.sphereOrderOffset},
+        {arrays.planes, (uint64_t)arrays.planeCount * sizeof(uint32_t), &header.planesOffset},
+        {arrays.sphereLayout, SphereBlock::layoutSize(arrays.sphereCount) * sizeof(float), &header.sphereLayoutOffset},
+    };
+    uint64_t offset = alignUp(sizeof(RtsbHeader));
+    for (const Section& section : sections) {
+        *section.offset = offset;
+        offset = alignUp(offset + section.bytes);
+    }
+    header.fileSize = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    const char zeros[RTSB_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (const Section& section : sections) {
+        file.write(zeros, (std::streamsize)(*section.offset - written));
+        file.write(static_cast<const char*>(section.data), (std::streamsize)section.bytes);
+        written = *section.offset + section.bytes;
+    }
+    file.write(zeros, (std::streamsize)(header.fileSize - written));
+    return (bool)file;
+}
+
+SceneSnapshot* SceneSnapshot::load(const std::string& path, std::string& error) {
+    std::unique_ptr<SceneSnapshot> scene(new SceneSnapshot());
+    if (!scene->mapping.open(path)) {
+        error = "cannot map file";
+        return nullptr;
+    }
+    const unsigned char* bytes = scene->mapping.data();
+    const uint64_t fileSize = scene->mapping.size();
+
+    RtsbHeader header;
+    if (fileSize < sizeof(header)) {
+        error = "file too small";
+        return nullptr;
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, RTSB_MAGIC, sizeof(header.magic)) != 0) {
+        error = "not an .rtsb file";
+        return nullptr;
+    }
+    if (header.version != RTSB_VERSION) {
+        error = "unsupported version " + std::to_string(header.version);
+        return nullptr;
+    }
+    if (header.byteOrder != RTSB_BYTE_ORDER || header.headerSize != sizeof(RtsbHeader) ||
+        header.surfaceSize != sizeof(Surface) || header.lightSize != sizeof(LightSource) ||
+        header.nodeSize != sizeof(BVH::Node) || header.cameraSize != sizeof(CameraBasis)) {
+        error = "written with a different byte order or record layout";
+        return nullptr;
+    }
+
+    const uint64_t maxCount = (uint64_t)std::numeric_limits<int>::max();
+    if (header.fileSize != fileSize || header.surfaceCount > maxCount || header.nodeCount > maxCount ||
+        header.sphereCount > maxCount || header.planeCount > maxCount ||
+        !sectionFits(header.surfacesOffset, header.surfaceCount, sizeof(Surface), fileSize) ||
+        !sectionFits(header.lightsOffset, header.lightCount, sizeof(LightSource), fileSize) ||
+        !sectionFits(header.nodesOffset, header.nodeCount, sizeof(BVH::Node), fileSize) ||
+        !sectionFits(header.sphereOrderOffset, header.sphereCount, sizeof(uint32_t), fileSize) ||
+        !sectionFits(header.planesOffset, header.planeCount, sizeof(uint32_t), fileSize) ||
+        !sectionFits(header.sphereLayoutOffset, SphereBlock::layoutSize(header.sphereCount), sizeof(float), fileSize)) {
+        error = "truncated or inconsistent sections";
+        return nullptr;
+    }
+
+    // Sections are used in place (the mapping is page aligned, sections are 64-byte aligned)
+    scene->surfaces = {reinterpret_cast<const Surface*>(bytes + header.surfacesOffset), header.surfaceCount};
+    scene->lights = {reinterpret_cast<const LightSource*>(bytes + header.lightsOffset), header.lightCount};
+    for (const Surface& surface : scene->surfaces) {
+        if (surface.kind > PLANE_PRIMITIVE || surface.material > GLASS) {
+            error = "invalid surface record";
+            return nullptr;
+        }
+    }
+    for (const LightSource& light : scene->lights) {
+        if (light.kind != PARALLEL_LIGHT && light.kind != CONE_LIGHT) {
+            error = "invalid light record";
+            return nullptr;
+        }
+    }
+
+    BVH::Arrays arrays;
+    arrays.nodes = reinterpret_cast<const BVH::Node*>(bytes + header.nodesOffset);
+    arrays.nodeCount = (int)header.nodeCount;
+    arrays.sphereOrder = reinterpret_cast<const uint32_t*>(bytes + header.sphereOrderOffset);
+    arrays.sphereCount = (int)header.sphereCount;
+    arrays.planes = reinterpret_cast<const uint32_t*>(bytes + header.planesOffset);
+    arrays.planeCount = (int)header.planeCount;
+    arrays.sphereLayout = reinterpret_cast<const float*>(bytes + header.sphereLayoutOffset);
+    if (!BVH::isValid(arrays, scene->surfaces.data(), (int)scene->surfaces.size())) {
+        error = "invalid BVH";
+        return nullptr;
+    }
+
+    scene->ambient = Vec3(header.ambient[0], header.ambient[1], header.ambient[2]);
+    scene->camera = header.camera;
+    scene->bvh.reset(new BVH(scene->surfaces.data(), arrays));
+    scene->lightGrids.reset(new LightGridSlot[scene->lights.size()]);
+    return scene.release();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Primitive.h"
+#include "Illumination.h"
+#include "Surface.h"
+#include "BVH.h"
+#include "LightGrid.h"
+#include "MappedFile.h"
+
+using Vec3 = glm::vec3;
+
+// Render-ready light. Directions are normalized once during compile:
+// for parallel lights, direction points toward the light (-d);
+// for cone lights, direction is the cone axis and position/cosCutoff are set.
+struct alignas(64) LightSource {
+    LightKind kind;           // Parallel or cone (ambient lights are not compiled)
+    float cosCutoff;          // Cone: cosine of the cutoff angle
+    Vec3 color;               // RGB color/intensity
+    Vec3 direction;           // See above
+    Vec3 position;            // Cone: world position
+
+    bool isConeType() const { return kind == CONE_LIGHT; }
+};
+
+// Camera basis and viewport extent. A scene stores its camera as given by its
+// e/u/f lines; configureViewport (Renderer.h) normalizes the directions and
+// fills in right, viewportCenter and a missing width for an image size.
+struct CameraBasis {
+    Vec3 eye;                 // Eye position
+    Vec3 forward;             // Forward direction
+    Vec3 up;                  // Up direction
+    Vec3 right;               // Right direction (set by configureViewport)
+    float focalLength = 1.0f; // Distance from eye to viewport plane
+    float viewportWidth = 0;  // Viewport size in world units (width 0: from the aspect ratio)
+    float viewportHeight = 0;
+    Vec3 viewportCenter;      // eye + forward * focalLength (set by configureViewport)
+};
+
+// Read-only view of a contiguous array (owned by the snapshot or in a mapped file)
+template <typename T>
+struct ArrayView {
+    const T* items = nullptr;
+    size_t count = 0;
+
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+    const T* data() const { return items; }
+    size_t size() const { return count; }
+    const T& operator[](size_t i) const { return items[i]; }
+};
+
+// Immutable, render-ready scene: compiled once after parsing, then shared
+// read-only by every render thread. Holds the surfaces, lights, ambient color,
+// camera and the BVH over the surfaces; the parsed objects can be deleted
+// as soon as the snapshot exists. The only state added later is a LightGrid
+// per parallel light, built by a render once enough shadow rays have gone
+// toward that light to pay for it.
+// A snapshot can be saved as a .rtsb file (see RtsbFormat.h) and loaded back by
+// memory-mapping it: the surfaces, lights and BVH are then used in place
+// (light grids are not stored).
+class SceneSnapshot {
+public:
+    // Compile parsed objects and lights (throws std::invalid_argument for
+    // degenerate primitives, e.g. a plane with a zero normal)
+    SceneSnapshot(const std::vector<Primitive*>& objects, const std::vector<Illumination*>& illuminators,
+                  const Vec3& ambientLight, const CameraBasis& view);
+
+    // The BVH points into surfaces, so a snapshot cannot be copied
+    SceneSnapshot(const SceneSnapshot&) = delete;
+    SceneSnapshot& operator=(const SceneSnapshot&) = delete;
+
+    // Map a .rtsb file and use it in place. Returns nullptr (and sets error)
+    // if it cannot be mapped or is not a valid file for this build.
+    static SceneSnapshot* load(const std::string& path, std::string& error);
+
+    // Write the snapshot as a .rtsb file; returns false on I/O errors
+    bool save(const std::string& path) const;
+
+    // Getters
+    ArrayView<Surface> getSurfaces() const { return surfaces; }
+    ArrayView<LightSource> getLights() const { return lights; }
+    const Vec3& getAmbient() const { return ambient; }
+    const CameraBasis& getCamera() const { return camera; }
+    const BVH& getBVH() const { return *bvh; }
+
+    // Shadow index of light i, or nullptr while it has none (cone lights never
+    // do; see countShadowRays for parallel lights)
+    const LightGrid* getLightGrid(size_t i) const { return lightGrids[i].ready.load(std::memory_order_acquire); }
+
+    // Record count more shadow rays toward light i tested with the BVH. Once a
+    // parallel light's rays would have paid for its LightGrid, the calling
+    // thread builds it; rays traced after that use it if it is usable.
+    void countShadowRays(size_t i, uint64_t count) const;
+
+private:
+    SceneSnapshot() = default;
+
+    // Grid of one light, built at most once by whichever thread first sees
+    // shadowRays reach the threshold
+    struct LightGridSlot {
+        std::atomic<uint64_t> shadowRays{0};
+        std::atomic<bool> building{false};
+        std::unique_ptr<LightGrid> grid;
+        std::atomic<const LightGrid*> ready{nullptr};  // grid once built and usable
+    };
+
+    // Storage: compiled vectors, or a mapped file
+    std::vector<Surface> ownedSurfaces;
+    std::vector<LightSource> ownedLights;
+    MappedFile mapping;
+
+    ArrayView<Surface> surfaces;      // in scene order
+    ArrayView<LightSource> lights;    // in scene order
+    Vec3 ambient = Vec3(0.0f);
+    CameraBasis camera;
+    std::unique_ptr<BVH> bvh;         // over surfaces
+    std::unique_ptr<LightGridSlot[]> lightGrids;  // per light
+};
@@ -0,0 +1,49 @@
+#include "SceneTokenizer.h"
+
+#include <charconv>
+#include <cstring>
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Constructor: start at the first line
+SceneTokenizer::SceneTokenizer(const char* begin, const char* end)
+    : cursor(begin), end(end) {}
+
+bool SceneTokenizer::next(SceneLine& line) {
+    while (cursor < end && error.empty()) {
+        const char* eol = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        if (!eol) eol = end;
+        const char* p = cursor;
+        cursor = (eol < end) ? eol + 1 : end;
+        ++lineNumber;
+
+        while (p < eol && isBlank(*p)) ++p;
+        if (p == eol) continue;  // blank line
+
+        line.command = *p++;
+        line.count = 0;
+        line.lineNumber = lineNumber;
+        while (true) {
+            while (p < eol && isBlank(*p)) ++p;
+            if (p == eol) break;
+
+            // from_chars does not accept a leading '+'
+            const char* token = (*p == '+') ? p + 1 : p;
+            float value;
+            std::from_chars_result result = std::from_chars(token, eol, value);
+            if (result.ec != std::errc() || (result.ptr < eol && !isBlank(*result.ptr))) {
+                const char* tokenEnd = p;
+                while (tokenEnd < eol && !isBlank(*tokenEnd)) ++tokenEnd;
+                error = "line " + std::to_string(lineNumber) + ": invalid number '" +
+                        std::string(p, tokenEnd) + "'";
+                return false;
+            }
+            if (line.count < SceneLine::MAX_ARGS) line.values[line.count++] = value;
+            p = result.ptr;
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+// One scene file line: command letter followed by its numeric arguments
+struct SceneLine {
+    static const int MAX_ARGS = 8;   // further values are checked but not stored
+
+    char command = 0;
+    float values[MAX_ARGS] = {};
+    int count = 0;                   // number of values stored
+    int lineNumber = 0;              // 1-based line in the file
+};
+
+// Tokenizer over a whole scene file held in memory. Scans the buffer in place
+// (numbers are parsed with std::from_chars) and fills a fixed-size SceneLine,
+// so no memory is allocated per line. Blank lines are skipped.
+class SceneTokenizer {
+public:
+    // Constructor: tokenize [begin, end); the buffer must outlive the tokenizer
+    SceneTokenizer(const char* begin, const char* end);
+
+    // Read the next non-blank line. Returns false at the end of the buffer or
+    // on a malformed number (then getError() describes it, with the line number).
+    bool next(SceneLine& line);
+
+    bool failed() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+
+private:
+    const char* cursor;   // start of the next line
+    const char* end;
+    int lineNumber = 0;
+    std::string error;    // only allocated when a line is rejected
+};
@@ -0,0 +1,255 @@
+#include "SphereBlock.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SPHERE_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPHERE_KERNEL_SSE
+#endif
+
+// Append a sphere and keep WIDTH - 1 lanes of padding behind the last one
+int SphereBlock::add(const Vec3& center, float radius) {
+    const size_t padded = paddedSize(count + 1);
+    ownedX.resize(padded, 0.0f);
+    ownedY.resize(padded, 0.0f);
+    ownedZ.resize(padded, 0.0f);
+    ownedR2.resize(padded, -1.0f);
+
+    ownedX[count] = center.x;
+    ownedY[count] = center.y;
+    ownedZ[count] = center.z;
+    ownedR2[count] = radius * radius;
+    cx = ownedX.data();
+    cy = ownedY.data();
+    cz = ownedZ.data();
+    r2 = ownedR2.data();
+    return count++;
+}
+
+// Sections are copied including their padding lanes
+void SphereBlock::copyLayout(float* layout) const {
+    const size_t padded = paddedSize(count);
+    if (count == 0) {
+        for (size_t i = 0; i < layoutSize(0); ++i) layout[i] = (i < 3 * padded) ? 0.0f : -1.0f;
+        return;
+    }
+    std::memcpy(layout, cx, padded * sizeof(float));
+    std::memcpy(layout + padded, cy, padded * sizeof(float));
+    std::memcpy(layout + 2 * padded, cz, padded * sizeof(float));
+    std::memcpy(layout + 3 * padded, r2, padded * sizeof(float));
+}
+
+void SphereBlock::view(const float* layout, int n) {
+    const size_t padded = paddedSize(n);
+    ownedX.clear();
+    ownedY.clear();
+    ownedZ.clear();
+    ownedR2.clear();
+    cx = layout;
+    cy = layout + padded;
+    cz = layout + 2 * padded;
+    r2 = layout + 3 * padded;
+    count = n;
+}
+
+const char* SphereBlock::kernelName() {
+#if defined(SPHERE_KERNEL_AVX2)
+    return "AVX2";
+#elif defined(SPHERE_KERNEL_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+// Test one ray against the 8 spheres starting at the given arrays.
+// Writes every lane's t to tOut and returns the bitmask of lanes hit inside (tmin, tmax).
+// Per lane (same as Sphere::intersect):
+//   proj = d . (c - o), distSq = |c - o|^2 - proj^2, miss if distSq > r^2
+//   t = proj - sqrt(r^2 - distSq), or proj + sqrt(...) if that is not beyond tmin
+static inline int intersect8(const float* cx, const float* cy, const float* cz, const float* r2,
+                             const Vec3& o, const Vec3& d, float tmin, float tmax, float* tOut) {
+#if defined(SPHERE_KERNEL_AVX2)
+    __m256 ocx = _mm256_sub_ps(_mm256_loadu_ps(cx), _mm256_set1_ps(o.x));
+    __m256 ocy = _mm256_sub_ps(_mm256_loadu_ps(cy), _mm256_set1_ps(o.y));
+    __m256 ocz = _mm256_sub_ps(_mm256_loadu_ps(cz), _mm256_set1_ps(o.z));
+    __m256 proj = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(d.x), ocx),
+                                              _mm256_mul_ps(_mm256_set1_ps(d.y), ocy)),
+                                _mm256_mul_ps(_mm256_set1_ps(d.z), ocz));
+    __m256 lenSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                 _mm256_mul_ps(ocz, ocz));
+    __m256 distSq = _mm256_sub_ps(lenSq, _mm256_mul_ps(proj, proj));
+    __m256 radSq = _mm256_loadu_ps(r2);
+    __m256 inside = _mm256_cmp_ps(distSq, radSq, _CMP_LE_OQ);
+
+    // Misses produce NaN here; they are masked out by inside
+    __m256 halfChord = _mm256_sqrt_ps(_mm256_sub_ps(radSq, distSq));
+    __m256 vtmin = _mm256_set1_ps(tmin);
+    __m256 tNear = _mm256_sub_ps(proj, halfChord);
+    __m256 tFar = _mm256_add_ps(proj, halfChord);
+    __m256 t = _mm256_blendv_ps(tFar, tNear, _mm256_cmp_ps(tNear, vtmin, _CMP_GT_OQ));
+
+    __m256 valid = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(t, vtmin, _CMP_GT_OQ),
+                                                       _mm256_cmp_ps(t, _mm256_set1_ps(tmax), _CMP_LT_OQ)));
+    _mm256_storeu_ps(tOut, t);
+    int mask = _mm256_movemask_ps(valid);
+
+    // Clear the upper register halves: unoptimized builds do not insert this, and
+    // dirty upper state makes every later legacy-SSE instruction (libm) pay a penalty
+    _mm256_zeroupper();
+    return mask;
+#elif defined(SPHERE_KERNEL_SSE)
+    int mask = 0;
+    for (int half = 0; half < 2; ++half) {
+        const int k = 4 * half;
+        __m128 ocx = _mm_sub_ps(_mm_loadu_ps(cx + k), _mm_set1_ps(o.x));
+        __m128 ocy = _mm_sub_ps(_mm_loadu_ps(cy + k), _mm_set1_ps(o.y));
+        __m128 ocz = _mm_sub_ps(_mm_loadu_ps(cz + k), _mm_set1_ps(o.z));
+        __m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(d.x), ocx),
+                                            _mm_mul_ps(_mm_set1_ps(d.y), ocy)),
+                                 _mm_mul_ps(_mm_set1_ps(d.z), ocz));
+        __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)),
+                                  _mm_mul_ps(ocz, ocz));
+        __m128 distSq = _mm_sub_ps(lenSq, _mm_mul_ps(proj, proj));
+        __m128 radSq = _mm_loadu_ps(r2 + k);
+        __m128 inside = _mm_cmple_ps(distSq, radSq);
+
+        __m128 halfChord = _mm_sqrt_ps(_mm_sub_ps(radSq, distSq));
+        __m128 vtmin = _mm_set1_ps(tmin);
+        __m128 tNear = _mm_sub_ps(proj, halfChord);
+        __m128 tFar = _mm_add_ps(proj, halfChord);
+        __m128 useNear = _mm_cmpgt_ps(tNear, vtmin);
+        __m128 t = _mm_or_ps(_mm_and_ps(useNear, tNear), _mm_andnot_ps(useNear, tFar));
+
+        __m128 valid = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(t, vtmin),
+                                                     _mm_cmplt_ps(t, _mm_set1_ps(tmax))));
+        _mm_storeu_ps(tOut + k, t);
+        mask |= _mm_movemask_ps(valid) << k;
+    }
+    return mask;
+#else
+    int mask = 0;
+    for (int i = 0; i < SphereBlock::WIDTH; ++i) {
+        float ocx = cx[i] - o.x, ocy = cy[i] - o.y, ocz = cz[i] - o.z;
+        float proj = (d.x * ocx + d.y * ocy) + d.z * ocz;
+        float distSq = (ocx * ocx + ocy * ocy) + ocz * ocz - proj * proj;
+        if (!(distSq <= r2[i])) continue;
+        float halfChord = std::sqrt(r2[i] - distSq);
+        float t = proj - halfChord;
+        if (!(t > tmin)) t = proj + halfChord;
+        tOut[i] = t;
+        if (t > tmin && t < tmax) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// Any-hit mask of 8 spheres for a ray without upper bound: a sphere is hit beyond
+// tmin iff its farther intersection proj + halfChord is, which is tested as
+// proj > tmin or (r^2 - distSq) > (tmin - proj)^2, avoiding the square root
+static inline int occluded8Unbounded(const float* cx, const float* cy, const float* cz, const float* r2,
+                                     const Vec3& o, const Vec3& d, float tmin) {
+#if defined(SPHERE_KERNEL_AVX2)
+    __m256 ocx = _mm256_sub_ps(_mm256_loadu_ps(cx), _mm256_set1_ps(o.x));
+    __m256 ocy = _mm256_sub_ps(_mm256_loadu_ps(cy), _mm256_set1_ps(o.y));
+    __m256 ocz = _mm256_sub_ps(_mm256_loadu_ps(cz), _mm256_set1_ps(o.z));
+    __m256 proj = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(d.x), ocx),
+                                              _mm256_mul_ps(_mm256_set1_ps(d.y), ocy)),
+                                _mm256_mul_ps(_mm256_set1_ps(d.z), ocz));
+    __m256 lenSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                 _mm256_mul_ps(ocz, ocz));
+    __m256 distSq = _mm256_sub_ps(lenSq, _mm256_mul_ps(proj, proj));
+    __m256 radSq = _mm256_loadu_ps(r2);
+    __m256 inside = _mm256_cmp_ps(distSq, radSq, _CMP_LE_OQ);
+
+    __m256 vtmin = _mm256_set1_ps(tmin);
+    __m256 gap = _mm256_sub_ps(vtmin, proj);
+    __m256 beyond = _mm256_or_ps(_mm256_cmp_ps(proj, vtmin, _CMP_GT_OQ),
+                                 _mm256_cmp_ps(_mm256_sub_ps(radSq, distSq), _mm256_mul_ps(gap, gap), _CMP_GT_OQ));
+    int mask = _mm256_movemask_ps(_mm256_and_ps(inside, beyond));
+    _mm256_zeroupper();
+    return mask;
+#elif defined(SPHERE_KERNEL_SSE)
+    int mask = 0;
+    for (int half = 0; half < 2; ++half) {
+        const int k = 4 * half;
+        __m128 ocx = _mm_sub_ps(_mm_loadu_ps(cx + k), _mm_set1_ps(o.x));
+        __m128 ocy = _mm_sub_ps(_mm_loadu_ps(cy + k), _mm_set1_ps(o.y));
+        __m128 ocz = _mm_sub_ps(_mm_loadu_ps(cz + k), _mm_set1_ps(o.z));
+        __m128 proj = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(d.x), ocx),
+                                            _mm_mul_ps(_mm_set1_ps(d.y), ocy)),
+                                 _mm_mul_ps(_mm_set1_ps(d.z), ocz));
+        __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)),
+                                  _mm_mul_ps(ocz, ocz));
+        __m128 distSq = _mm_sub_ps(lenSq, _mm_mul_ps(proj, proj));
+        __m128 radSq = _mm_loadu_ps(r2 + k);
+        __m128 inside = _mm_cmple_ps(distSq, radSq);
+
+        __m128 vtmin = _mm_set1_ps(tmin);
+        __m128 gap = _mm_sub_ps(vtmin, proj);
+        __m128 beyond = _mm_or_ps(_mm_cmpgt_ps(proj, vtmin),
+                                  _mm_cmpgt_ps(_mm_sub_ps(radSq, distSq), _mm_mul_ps(gap, gap)));
+        mask |= _mm_movemask_ps(_mm_and_ps(inside, beyond)) << k;
+    }
+    return mask;
+#else
+    int mask = 0;
+    for (int i = 0; i < SphereBlock::WIDTH; ++i) {
+        float ocx = cx[i] - o.x, ocy = cy[i] - o.y, ocz = cz[i] - o.z;
+        float proj = (d.x * ocx + d.y * ocy) + d.z * ocz;
+        float distSq = (ocx * ocx + ocy * ocy) + ocz * ocz - proj * proj;
+        if (!(distSq <= r2[i])) continue;
+        float gap = tmin - proj;
+        if (proj > tmin || r2[i] - distSq > gap * gap) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+// Closest hit: scan the range 8 lanes at a time, shrinking tmax as hits are found.
+// On equal t the lowest lane wins, like a sequential loop with a strict '<'.
+int SphereBlock::closestHit(const Vec3& origin, const Vec3& dir, int first, int n,
+                            float tmin, float& tmax) const {
+    int best = -1;
+    float t[WIDTH];
+    for (int base = first; base < first + n; base += WIDTH) {
+        int mask = intersect8(&cx[base], &cy[base], &cz[base], &r2[base], origin, dir, tmin, tmax, t);
+        int remaining = first + n - base;
+        if (remaining < WIDTH) mask &= (1 << remaining) - 1;
+        for (int i = 0; mask != 0; ++i, mask >>= 1) {
+            if ((mask & 1) && t[i] < tmax) {
+                tmax = t[i];
+                best = base + i;
+            }
+        }
+    }
+    return best;
+}
+
+// Any hit: stop at the first 8-lane group containing a valid hit
+bool SphereBlock::anyHit(const Vec3& origin, const Vec3& dir, int first, int n,
+                         float tmin, float tmax) const {
+    return firstOccluder(origin, dir, first, n, tmin, tmax) >= 0;
+}
+
+int SphereBlock::firstOccluder(const Vec3& origin, const Vec3& dir, int first, int n,
+                               float tmin, float tmax) const {
+    const bool unbounded = std::isinf(tmax);
+    float t[WIDTH];
+    for (int base = first; base < first + n; base += WIDTH) {
+        int mask = unbounded
+            ? occluded8Unbounded(&cx[base], &cy[base], &cz[base], &r2[base], origin, dir, tmin)
+            : intersect8(&cx[base], &cy[base], &cz[base], &r2[base], origin, dir, tmin, tmax, t);
+        int remaining = first + n - base;
+        if (remaining < WIDTH) mask &= (1 << remaining) - 1;
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1) {
+            if (mask & 1) return base + lane;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+using Vec3 = glm::vec3;
+
+// Structure-of-arrays sphere storage with an 8-wide intersection kernel.
+// One ray is tested against 8 spheres per instruction: AVX2 when the compiler
+// targets it, two SSE halves otherwise, and a scalar loop on other CPUs.
+// All paths evaluate the same expressions in the same order, so they agree bit for bit.
+// Ray directions must be normalized (t is the distance from the origin).
+// The arrays are either owned (filled with add) or viewed in an external layout
+// (see view), e.g. a memory-mapped scene file.
+class SphereBlock {
+public:
+    static const int WIDTH = 8;  // spheres per kernel step
+
+    SphereBlock() = default;
+
+    // Queries read through pointers into the storage, so blocks are not copied
+    SphereBlock(const SphereBlock&) = delete;
+    SphereBlock& operator=(const SphereBlock&) = delete;
+
+    // Append a sphere; returns its lane index
+    int add(const Vec3& center, float radius);
+
+    // Number of stored spheres
+    int size() const { return count; }
+
+    // Flat layout: cx, cy, cz and r2 sections of paddedSize(count) floats each
+    static size_t paddedSize(int n) { return (size_t)n + WIDTH - 1; }
+    static size_t layoutSize(int n) { return 4 * paddedSize(n); }
+
+    // Copy the spheres into layout (layoutSize(size()) floats)
+    void copyLayout(float* layout) const;
+
+    // Use n spheres stored in layout (not copied; it must outlive the block)
+    void view(const float* layout, int n);
+
+    // Sphere in lane i
+    Vec3 center(int i) const { return Vec3(cx[i], cy[i], cz[i]); }
+    float radiusSq(int i) const { return r2[i]; }
+
+    // Closest sphere in lanes [first, first + n) hit inside (tmin, tmax).
+    // Returns its lane index and shrinks tmax to its t, or -1 if none is hit.
+    int closestHit(const Vec3& origin, const Vec3& dir, int first, int n, float tmin, float& tmax) const;
+
+    // Whether any sphere in lanes [first, first + n) is hit inside (tmin, tmax).
+    // With an infinite tmax (parallel lights) a square-root-free test is used.
+    bool anyHit(const Vec3& origin, const Vec3& dir, int first, int n, float tmin, float tmax) const;
+
+    // anyHit that also says which sphere: the first lane in [first, first + n)
+    // hit inside (tmin, tmax), or -1
+    int firstOccluder(const Vec3& origin, const Vec3& dir, int first, int n, float tmin, float tmax) const;
+
+    // Name of the kernel compiled in (for logging)
+    static const char* kernelName();
+
+private:
+    // Arrays are kept WIDTH - 1 lanes longer than count so that a full
+    // 8-wide load starting at any valid lane stays in bounds
+    const float* cx = nullptr;
+    const float* cy = nullptr;
+    const float* cz = nullptr;
+    const float* r2 = nullptr;
+    int count = 0;
+
+    // Owned storage behind the pointers (empty for a view)
+    std::vector<float> ownedX, ownedY, ownedZ, ownedR2;
+};
@@ -0,0 +1,77 @@
+#include "Surface.h"
+
+#include <cmath>
+
+// Surface normal: normalized vector from center to point (spheres), precomputed -n (planes)
+Vec3 Surface::get_normal(const Vec3& p) const {
+    if (kind == PLANE_PRIMITIVE) return shadingNormal;
+    return glm::normalize(p - point);
+}
+
+// Ray-sphere intersection uses the geometric method (same arithmetic as the
+// SphereBlock kernel used for BVH traversal); ray-plane uses the parametric form
+bool Surface::intersect(const RayCast& ray, float tmin, HitResult& hit) const
+{
+    const Vec3& dir = ray.getDirection();
+    float t;
+    if (kind == SPHERE_PRIMITIVE) {
+        Vec3 toCenter = point - ray.getOrigin();
+
+        // Project ray direction onto vector to center
+        float proj = glm::dot(dir, toCenter);
+
+        // Distance squared from ray to center (using Pythagorean theorem)
+        float distSq = glm::dot(toCenter, toCenter) - (proj * proj);
+
+        // Ray misses sphere if distance > radius
+        if(distSq > radiusSq) return false;
+
+        // Calculate intersection points using chord length
+        float halfChord = glm::sqrt(radiusSq - distSq);
+        t = proj - halfChord;                     // Closer intersection
+        if(t <= tmin) t = proj + halfChord;       // Origin inside sphere: farther intersection
+    } else {
+        // Check if ray is parallel to plane
+        float ndotd = glm::dot(normal, dir);
+        if(std::abs(ndotd) < 1e-6) return false;
+
+        // Calculate intersection parameter t
+        t = glm::dot(normal, (point - ray.getOrigin())) / ndotd;
+    }
+
+    // Accept only hits inside the search interval
+    if(t <= tmin || t >= hit.get_t()) return false;
+    hit.record(t, this);
+    return true;
+}
+
+// Any-hit test: same setup as intersect, but only answers yes/no
+bool Surface::occludes(const RayCast& ray, float tmin, float tmax) const
+{
+    const Vec3& dir = ray.getDirection();
+    if (kind == PLANE_PRIMITIVE) {
+        // t = num / ndotd is compared against the interval without dividing
+        // (tmax * ndotd stays infinite for unbounded rays)
+        float ndotd = glm::dot(normal, dir);
+        if(std::abs(ndotd) < 1e-6) return false;
+
+        float num = glm::dot(normal, point - ray.getOrigin());
+        if(ndotd > 0) return num > tmin * ndotd && num < tmax * ndotd;
+        return num < tmin * ndotd && num > tmax * ndotd;
+    }
+
+    Vec3 toCenter = point - ray.getOrigin();
+    float proj = glm::dot(dir, toCenter);
+    float distSq = glm::dot(toCenter, toCenter) - (proj * proj);
+    if(distSq > radiusSq) return false;
+
+    // Unbounded ray: it is enough that the farther intersection lies beyond tmin,
+    // i.e. proj + halfChord > tmin, which needs no square root
+    float chordSq = radiusSq - distSq;
+    if(std::isinf(tmax)) return proj > tmin || chordSq > (tmin - proj) * (tmin - proj);
+
+    float halfChord = glm::sqrt(chordSq);
+    float t = proj - halfChord;
+    if(t <= tmin) t = proj + halfChord;
+    return t > tmin && t < tmax;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Primitive.h"
+#include "RayCast.h"
+#include "HitResult.h"
+
+using Vec3 = glm::vec3;
+
+// Render-ready primitive: material plus geometry with its per-ray invariants
+// precomputed (sphere radius squared, plane point and shading normal).
+// Compiled from a Primitive by SceneSnapshot and never modified while rendering.
+// A record fills exactly one cache line.
+struct alignas(64) Surface {
+    PrimitiveKind kind;       // Sphere or plane
+    MaterialType material;    // Standard/mirror/glass
+    float shininess;          // Specular shininess exponent
+    float radius;             // Sphere radius (0 for planes)
+    float radiusSq;           // Sphere radius squared
+    Vec3 color;               // Base color (RGB)
+    Vec3 point;               // Sphere center, or a point on the plane
+    Vec3 normal;              // Plane normal as given in the scene (unused for spheres)
+    Vec3 shadingNormal;       // Plane: normalize(-normal) (unused for spheres)
+
+    // Material and type queries (same names as Primitive)
+    bool is_plane() const { return kind == PLANE_PRIMITIVE; }
+    bool is_reflective() const { return material == MIRROR; }
+    bool is_transparent() const { return material == GLASS; }
+    const Vec3& get_rgb() const { return color; }
+    float get_shininess() const { return shininess; }
+
+    // Surface normal at point p (spheres: away from the center, planes: -normal)
+    Vec3 get_normal(const Vec3& p) const;
+
+    // Intersect ray with the surface inside the open interval (tmin, hit.get_t()).
+    // Rays are normalized, so t is the distance from the ray origin.
+    // On a closer hit, records it in hit (shrinking tmax) and returns true.
+    bool intersect(const RayCast& ray, float tmin, HitResult& hit) const;
+
+    // Any-hit query for shadow rays: whether the ray hits the surface inside
+    // (tmin, tmax). Computes no hit point; tmax is infinite for parallel lights.
+    bool occludes(const RayCast& ray, float tmin, float tmax) const;
+};
+
+static_assert(sizeof(Surface) == 64, "Surface must fill one cache line");
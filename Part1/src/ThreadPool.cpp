@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+// Constructor: spawn threadCount - 1 workers (the caller is participant 0)
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+// Destructor: wake all workers and wait for them to exit
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Distribute contiguous index ranges over the participant queues, then help
+// drain them until every item has been executed
+void ThreadPool::parallelFor(int count, const Body& body) {
+    if (count <= 0) return;
+
+    const unsigned participants = getThreadCount();
+    if (participants == 1) {
+        for (int i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.remaining.store(count);
+    for (unsigned q = 0; q < participants; ++q) {
+        int begin = (int)((long long)count * q / participants);
+        int end = (int)((long long)count * (q + 1) / participants);
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        for (int i = begin; i < end; ++i) queues[q]->items.push_back({&batch, i});
+    }
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> guard(stateLock);
+    batchDone.wait(guard, [&batch] { return batch.remaining.load() == 0; });
+}
+
+// Take the oldest item from our own queue (keeps neighbouring items together)
+bool ThreadPool::popLocal(unsigned self, WorkItem& item) {
+    WorkQueue& queue = *queues[self];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.items.empty()) return false;
+    item = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+// Take the newest item from another participant's queue
+bool ThreadPool::steal(unsigned self, WorkItem& item) {
+    const unsigned participants = getThreadCount();
+    for (unsigned offset = 1; offset < participants; ++offset) {
+        WorkQueue& victim = *queues[(self + offset) % participants];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.items.empty()) continue;
+        item = victim.items.back();
+        victim.items.pop_back();
+        return true;
+    }
+    return false;
+}
+
+// Execute items until no queue has any work left
+void ThreadPool::drain(unsigned self) {
+    WorkItem item;
+    while (popLocal(self, item) || steal(self, item)) {
+        (*item.batch->body)(item.index);
+        // The batch may be gone as soon as its count reaches zero
+        if (item.batch->remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> guard(stateLock);
+            batchDone.notify_all();
+        }
+    }
+}
+
+// Worker thread: sleep until a new batch is published, then drain
+void ThreadPool::workerLoop(unsigned self) {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(stateLock);
+            wakeWorkers.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain(self);
+    }
+}
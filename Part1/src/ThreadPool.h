@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool: every participant owns a deque of work items.
+// Owners pop from the front of their own deque, idle participants steal from
+// the back of the others. The calling thread takes part in every batch.
+// Several threads may run batches at the same time (e.g. rendering one scene
+// while encoding another); every caller waits only for its own batch.
+class ThreadPool {
+public:
+    using Body = std::function<void(int)>;
+
+    // Constructor: 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of participants (worker threads + calling thread)
+    unsigned getThreadCount() const { return (unsigned)queues.size(); }
+
+    // Run body(i) for every i in [0, count) and block until all are finished
+    // (while waiting, the caller also executes items of other batches)
+    void parallelFor(int count, const Body& body);
+
+private:
+    // One parallelFor call; lives on the caller's stack until remaining is 0
+    struct Batch {
+        const Body* body;
+        std::atomic<int> remaining;
+    };
+
+    // Single work item: the batch travels with the index so a late
+    // worker can never run an index against the wrong batch
+    struct WorkItem {
+        Batch* batch;
+        int index;
+    };
+
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<WorkItem> items;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;  // queues[0] is shared by the calling threads
+    std::vector<std::thread> workers;
+
+    std::mutex stateLock;
+    std::condition_variable wakeWorkers;   // new batch or shutdown
+    std::condition_variable batchDone;     // some batch's remaining reached zero
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    bool popLocal(unsigned self, WorkItem& item);
+    bool steal(unsigned self, WorkItem& item);
+    void drain(unsigned self);
+    void workerLoop(unsigned self);
+};
@@ -0,0 +1,393 @@
+#include "TileFarm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Renderer.h"
+
+#ifdef _WIN32
+
+bool TileFarm::render(const std::string&, ImageBuffer&, std::string& error) {
+    error = "the tile farm needs POSIX processes and pipes, which this build does not support";
+    return false;
+}
+
+int TileFarm::serve(ThreadPool&) {
+    return 1;
+}
+
+#else
+
+using Clock = std::chrono::steady_clock;
+
+// Write all of length bytes; false if the other side went away
+static bool sendAll(int fd, const void* data, size_t length) {
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t count = ::write(fd, bytes, length);
+        if (count <= 0) return false;
+        bytes += count;
+        length -= (size_t)count;
+    }
+    return true;
+}
+
+static bool sendLine(int fd, const std::string& line) {
+    return sendAll(fd, (line + "\n").data(), line.size() + 1);
+}
+
+// Split the first line off buffer (without the newline); false if none is complete
+static bool takeLine(std::string& buffer, std::string& line) {
+    size_t newline = buffer.find('\n');
+    if (newline == std::string::npos) return false;
+    line = buffer.substr(0, newline);
+    buffer.erase(0, newline + 1);
+    return true;
+}
+
+// Bytes of one tile message: 8-bit RGB, plus float RGB with radiance
+static size_t tileBytes(int width, int height, bool radiance) {
+    const size_t pixels = (size_t)width * height;
+    return 3 * pixels + (radiance ? 3 * pixels * sizeof(float) : 0);
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+int TileFarm::serve(ThreadPool& pool) {
+    // The coordinator may go away; writes then fail instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+
+    std::unique_ptr<SceneSnapshot> scene;
+    std::unique_ptr<RenderContext> context;
+    bool radiance = false;
+
+    std::string buffer, line;
+    char chunk[4096];
+    for (;;) {
+        while (!takeLine(buffer, line)) {
+            ssize_t count = ::read(0, chunk, sizeof(chunk));
+            if (count <= 0) return 0;  // coordinator closed our stdin: done
+            buffer.append(chunk, (size_t)count);
+        }
+
+        std::istringstream words(line);
+        std::string kind;
+        words >> kind;
+        if (kind == "scene") {
+            int width = 0, height = 0, packets = 0, withRadiance = 0, maxDepth = 0, wavefront = 0;
+            std::string path;
+            words >> width >> height >> packets >> withRadiance >> maxDepth >> wavefront;
+            std::getline(words >> std::ws, path);
+            std::string error;
+            context.reset();
+            scene.reset(words && width > 0 && height > 0 && maxDepth >= 0 ? loadScene(path, error) : nullptr);
+            if (!scene) {
+                if (!sendLine(1, "error " + (error.empty() ? std::string("bad scene message") : error))) return 1;
+                continue;
+            }
+            context.reset(new RenderContext(*scene, scene->getCamera(), width, height, packets != 0, maxDepth,
+                                            wavefront != 0));
+            radiance = withRadiance != 0;
+            if (!sendLine(1, "ready")) return 1;
+        } else if (kind == "tile") {
+            long long id = 0;
+            int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+            words >> id >> x0 >> y0 >> x1 >> y1;
+            if (!context || !words || x0 < 0 || y0 < 0 || x1 <= x0 || y1 <= y0 ||
+                x1 > context->width || y1 > context->height) {
+                if (!sendLine(1, "error bad tile message")) return 1;
+                continue;
+            }
+            ImageBuffer tile(x1 - x0, y1 - y0, radiance);
+            renderRegion(*context, x0, y0, tile, pool);
+            const size_t bytes = tileBytes(tile.width, tile.height, radiance);
+            if (!sendLine(1, "tile " + std::to_string(id) + " " + std::to_string(bytes)) ||
+                !sendAll(1, tile.rgb.data(), tile.rgb.size()) ||
+                (radiance && !sendAll(1, tile.radiance.data(), tile.radiance.size() * sizeof(float)))) {
+                return 1;
+            }
+        } else {
+            if (!sendLine(1, "error unknown message '" + kind + "'")) return 1;
+        }
+    }
+}
+
+// ============================================================================
+// COORDINATOR
+// ============================================================================
+
+namespace {
+
+struct Tile {
+    int x0, y0, x1, y1;
+    bool done = false;
+};
+
+struct Lease {
+    int worker;
+    Clock::time_point deadline;
+};
+
+struct Worker {
+    pid_t pid = -1;
+    int input = -1;           // worker's stdin (we write)
+    int output = -1;          // worker's stdout (we read)
+    bool alive = false;
+    bool ready = false;
+    std::string buffer;       // received, not yet parsed
+    int payloadTile = -1;     // tile whose pixels follow in buffer
+    size_t payloadBytes = 0;
+    std::vector<int> sent;    // tiles sent and not answered yet
+};
+
+}
+
+// Start command through /bin/sh with pipes on its stdin and stdout
+static bool spawnWorker(const std::string& command, Worker& worker) {
+    int toChild[2], fromChild[2];
+    if (::pipe(toChild) != 0) return false;
+    if (::pipe(fromChild) != 0) {
+        ::close(toChild[0]);
+        ::close(toChild[1]);
+        return false;
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]}) ::close(fd);
+        return false;
+    }
+    if (pid == 0) {
+        ::setpgid(0, 0);  // own process group, so the shell's children are stopped with it
+        ::dup2(toChild[0], 0);
+        ::dup2(fromChild[1], 1);
+        for (int fd : {toChild[0], toChild[1], fromChild[0], fromChild[1]}) ::close(fd);
+        ::execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+        ::_exit(127);
+    }
+    ::close(toChild[0]);
+    ::close(fromChild[1]);
+    // Later workers must not inherit these ends, or this worker would never see EOF
+    ::fcntl(toChild[1], F_SETFD, FD_CLOEXEC);
+    ::fcntl(fromChild[0], F_SETFD, FD_CLOEXEC);
+    worker.pid = pid;
+    worker.input = toChild[1];
+    worker.output = fromChild[0];
+    worker.alive = true;
+    return true;
+}
+
+bool TileFarm::render(const std::string& scenePath, ImageBuffer& image, std::string& error) {
+    signal(SIGPIPE, SIG_IGN);
+    const bool radiance = !image.radiance.empty();
+    const int tileSize = std::max(settings.tileSize, 1);
+
+    std::vector<Tile> tiles;
+    for (int y = 0; y < image.height; y += tileSize) {
+        for (int x = 0; x < image.width; x += tileSize) {
+            tiles.push_back({x, y, std::min(x + tileSize, image.width), std::min(y + tileSize, image.height)});
+        }
+    }
+    std::deque<int> pending;
+    for (int i = 0; i < (int)tiles.size(); ++i) pending.push_back(i);
+    std::map<int, Lease> leases;   // at most one live lease per tile
+    size_t remaining = tiles.size();
+
+    std::vector<Worker> workers(std::max(1u, settings.workers));
+    const std::string sceneLine = "scene " + std::to_string(image.width) + " " + std::to_string(image.height) + " " +
+                                  (settings.packetTracing ? "1" : "0") + " " + (radiance ? "1" : "0") + " " + std::to_string(settings.maxDepth) + " " +
+                                  (settings.wavefront ? "1" : "0") + " " + scenePath;
+    for (Worker& worker : workers) {
+        // A worker that fails to start shows up as end of file below
+        if (spawnWorker(settings.workerCommand, worker)) sendLine(worker.input, sceneLine);
+    }
+
+    // Stop using a worker: its live leases go back to the front of the queue
+    auto retire = [&](Worker& worker, int index) {
+        if (!worker.alive) return;
+        worker.alive = false;
+        ::close(worker.input);
+        ::close(worker.output);
+        ::kill(-worker.pid, SIGTERM);
+        for (int tile : worker.sent) {
+            auto lease = leases.find(tile);
+            if (lease != leases.end() && lease->second.worker == index) {
+                leases.erase(lease);
+                pending.push_front(tile);
+            }
+        }
+        worker.sent.clear();
+    };
+
+    // Copy one returned tile into the frame (unless another worker was first)
+    auto acceptTile = [&](Worker& worker, int tileIndex, const char* pixels) {
+        worker.sent.erase(std::find(worker.sent.begin(), worker.sent.end(), tileIndex));
+        Tile& tile = tiles[tileIndex];
+        leases.erase(tileIndex);
+        if (tile.done) return;
+        const int width = tile.x1 - tile.x0, height = tile.y1 - tile.y0;
+        const float* floats = reinterpret_cast<const float*>(pixels + 3 * (size_t)width * height);
+        for (int row = 0; row < height; ++row) {
+            const size_t frameOffset = 3 * ((size_t)(tile.y0 + row) * image.width + tile.x0);
+            std::memcpy(&image.rgb[frameOffset], pixels + 3 * (size_t)row * width, 3 * (size_t)width);
+            if (radiance) {
+                std::memcpy(&image.radiance[frameOffset], floats + 3 * (size_t)row * width,
+                            3 * sizeof(float) * width);
+            }
+        }
+        tile.done = true;
+        --remaining;
+    };
+
+    // Parse everything complete in a worker's buffer; false on a protocol error
+    auto parseMessages = [&](Worker& worker) {
+        std::string line;
+        for (;;) {
+            if (worker.payloadTile >= 0) {
+                if (worker.buffer.size() < worker.payloadBytes) return true;
+                acceptTile(worker, worker.payloadTile, worker.buffer.data());
+                worker.buffer.erase(0, worker.payloadBytes);
+                worker.payloadTile = -1;
+                continue;
+            }
+            if (!takeLine(worker.buffer, line)) return true;
+            std::istringstream words(line);
+            std::string kind;
+            words >> kind;
+            if (kind == "ready") {
+                worker.ready = true;
+            } else if (kind == "tile") {
+                int tile = -1;
+                size_t bytes = 0;
+                words >> tile >> bytes;
+                if (!words || std::find(worker.sent.begin(), worker.sent.end(), tile) == worker.sent.end() ||
+                    bytes != tileBytes(tiles[tile].x1 - tiles[tile].x0, tiles[tile].y1 - tiles[tile].y0, radiance)) {
+                    error = "worker sent a bad tile message: " + line;
+                    return false;
+                }
+                worker.payloadTile = tile;
+                worker.payloadBytes = bytes;
+            } else {
+                error = line.compare(0, 6, "error ") == 0 ? line.substr(6) : "worker sent: " + line;
+                return false;
+            }
+        }
+    };
+
+    // Workers must answer the scene line within one lease timeout, or they
+    // would never get a lease and the render could wait for them forever
+    const Clock::time_point startDeadline =
+        Clock::now() + std::chrono::milliseconds((long long)(settings.leaseTimeout * 1000));
+
+    std::vector<char> chunk(1 << 16);
+    while (remaining > 0) {
+        const Clock::time_point now = Clock::now();
+
+        if (now >= startDeadline) {
+            for (int index = 0; index < (int)workers.size(); ++index) {
+                if (!workers[index].alive || workers[index].ready) continue;
+                if (error.empty()) error = "worker did not load the scene within the lease timeout";
+                retire(workers[index], index);
+            }
+        }
+
+        // Leases past their deadline are issued again (the slow worker keeps
+        // the slot, so a hung worker is not given more tiles)
+        for (auto lease = leases.begin(); lease != leases.end();) {
+            if (lease->second.deadline > now) {
+                ++lease;
+                continue;
+            }
+            pending.push_front(lease->first);
+            lease = leases.erase(lease);
+        }
+
+        // Hand out tiles
+        for (int index = 0; index < (int)workers.size(); ++index) {
+            Worker& worker = workers[index];
+            while (worker.alive && worker.ready && worker.sent.size() < settings.leasesPerWorker && !pending.empty()) {
+                const int tileIndex = pending.front();
+                pending.pop_front();
+                const Tile& tile = tiles[tileIndex];
+                if (tile.done || leases.count(tileIndex)) continue;
+                if (!sendLine(worker.input, "tile " + std::to_string(tileIndex) + " " + std::to_string(tile.x0) + " " +
+                                                std::to_string(tile.y0) + " " + std::to_string(tile.x1) + " " +
+                                                std::to_string(tile.y1))) {
+                    pending.push_front(tileIndex);
+                    retire(worker, index);
+                    break;
+                }
+                worker.sent.push_back(tileIndex);
+                leases[tileIndex] = {index, now + std::chrono::milliseconds((long long)(settings.leaseTimeout * 1000))};
+            }
+        }
+
+        // Wait for output until the next lease deadline
+        std::vector<pollfd> polled;
+        std::vector<int> polledWorkers;
+        for (int index = 0; index < (int)workers.size(); ++index) {
+            if (!workers[index].alive) continue;
+            polled.push_back({workers[index].output, POLLIN, 0});
+            polledWorkers.push_back(index);
+        }
+        if (polled.empty()) {
+            if (error.empty()) error = "no worker could be started";
+            break;
+        }
+        int timeout = 1000;
+        auto waitUntil = [&](Clock::time_point deadline) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            timeout = (int)std::max<long long>(0, std::min<long long>(timeout, wait + 1));
+        };
+        for (const auto& lease : leases) waitUntil(lease.second.deadline);
+        for (const Worker& worker : workers) {
+            if (worker.alive && !worker.ready) waitUntil(startDeadline);
+        }
+        if (::poll(polled.data(), polled.size(), timeout) <= 0) continue;
+
+        for (size_t i = 0; i < polled.size(); ++i) {
+            if (!polled[i].revents) continue;
+            Worker& worker = workers[polledWorkers[i]];
+            ssize_t count = ::read(worker.output, chunk.data(), chunk.size());
+            if (count > 0) {
+                worker.buffer.append(chunk.data(), (size_t)count);
+                if (parseMessages(worker)) continue;
+            } else if (error.empty()) {
+                error = "worker exited";
+            }
+            retire(worker, polledWorkers[i]);
+        }
+    }
+
+    // Close every stdin (idle workers exit); stop workers still busy with stale
+    // leases or still starting, which may not read stdin yet
+    for (Worker& worker : workers) {
+        if (!worker.alive) continue;
+        ::close(worker.input);
+        ::close(worker.output);
+        if (!worker.sent.empty() || !worker.ready) ::kill(-worker.pid, SIGTERM);
+    }
+    for (Worker& worker : workers) {
+        if (worker.pid > 0) ::waitpid(worker.pid, nullptr, 0);
+    }
+    if (remaining > 0) return false;
+    error.clear();
+    return true;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+#include "ImageWriter.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+// Farm options set from the command line
+struct FarmSettings {
+    unsigned workers = 0;           // worker processes
+    std::string workerCommand;      // shell command starting one worker (see TileFarm)
+    int tileSize = 256;             // edge length of one lease, in pixels
+    double leaseTimeout = 120.0;    // seconds before a leased tile is handed out again
+    unsigned leasesPerWorker = 2;   // tiles outstanding per worker, so workers never idle
+    bool packetTracing = false;
+    bool wavefront = false;         // RenderContext::wavefront
+    int maxDepth = DEFAULT_MAX_DEPTH; // bounces after the primary hit (RenderContext::maxDepth)
+};
+
+// Renders one frame across several worker processes (POSIX only).
+// The coordinator starts settings.workers copies of workerCommand through
+// /bin/sh and talks to each over its stdin/stdout, so a worker may run on
+// another host (e.g. "ssh host /path/raytracer.exe --tile-worker"; the scene
+// path must then be valid on that host). Protocol, one header line per message:
+//   -> scene WIDTH HEIGHT PACKETS RADIANCE DEPTH WAVEFRONT PATH
+//                                                  <- ready | error MESSAGE
+//   -> tile ID X0 Y0 X1 Y1                         <- tile ID BYTES, then BYTES of
+//      pixels: 8-bit RGB rows, followed by float RGB rows if RADIANCE is 1
+// The frame is split into tileSize tiles. Each worker holds up to
+// leasesPerWorker leases; a lease that is not answered within leaseTimeout is
+// issued again to any worker, and a worker that exits returns its leases at
+// once. A worker that has not answered the scene line within leaseTimeout is
+// stopped. The first result for a tile wins, later duplicates are dropped.
+class TileFarm {
+public:
+    explicit TileFarm(const FarmSettings& settings) : settings(settings) {}
+
+    // Render scenePath into image (whose size is the frame size). Returns
+    // false and sets error if the scene fails to load or every worker fails.
+    bool render(const std::string& scenePath, ImageBuffer& image, std::string& error);
+
+    // Worker side: answer scene and tile messages on stdin/stdout until stdin
+    // closes. Returns the process exit code.
+    static int serve(ThreadPool& pool);
+
+private:
+    const FarmSettings settings;
+};
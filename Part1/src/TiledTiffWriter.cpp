@@ -0,0 +1,110 @@
+#include "TiledTiffWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+// TIFF field types and tags used here
+enum : uint16_t { TYPE_SHORT = 3, TYPE_LONG = 4, TYPE_LONG8 = 16 };
+enum : uint16_t {
+    TAG_IMAGE_WIDTH = 256, TAG_IMAGE_LENGTH = 257, TAG_BITS_PER_SAMPLE = 258, TAG_COMPRESSION = 259,
+    TAG_PHOTOMETRIC = 262, TAG_SAMPLES_PER_PIXEL = 277, TAG_PLANAR_CONFIG = 284,
+    TAG_TILE_WIDTH = 322, TAG_TILE_LENGTH = 323, TAG_TILE_OFFSETS = 324, TAG_TILE_BYTE_COUNTS = 325
+};
+static const int ENTRY_COUNT = 11;
+static const uint64_t HEADER_SIZE = 16;
+
+// Append value as little-endian bytes
+static void putLittleEndian(std::vector<unsigned char>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+TiledTiffWriter::TiledTiffWriter(int width, int height, int tileSize)
+    : width(width), height(height), tileSize(tileSize),
+      tilesAcross((width + tileSize - 1) / tileSize), tilesDown((height + tileSize - 1) / tileSize),
+      tile(3 * (size_t)tileSize * tileSize) {}
+
+bool TiledTiffWriter::open(const std::string& path) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+
+    // The directory follows the fixed-size tile data, so its offset is known now
+    const uint64_t tileCount = (uint64_t)tilesAcross * tilesDown;
+    const uint64_t directoryOffset = HEADER_SIZE + tileCount * tile.size();
+    std::vector<unsigned char> header = {'I', 'I'};
+    putLittleEndian(header, 43, 2);  // BigTIFF
+    putLittleEndian(header, 8, 2);   // offset size
+    putLittleEndian(header, 0, 2);
+    putLittleEndian(header, directoryOffset, 8);
+    file.write(reinterpret_cast<const char*>(header.data()), (std::streamsize)header.size());
+    return (bool)file;
+}
+
+bool TiledTiffWriter::writeBand(const ImageBuffer& band) {
+    const int rows = std::min(tileSize, height - bandsWritten * tileSize);
+    if (bandsWritten >= tilesDown || band.width != width || band.height != rows) return false;
+
+    const size_t tileRowBytes = 3 * (size_t)tileSize;
+    for (int across = 0; across < tilesAcross; ++across) {
+        const int x0 = across * tileSize;
+        const size_t rowBytes = 3 * (size_t)std::min(tileSize, width - x0);
+        std::fill(tile.begin(), tile.end(), 0);
+        for (int row = 0; row < rows; ++row) {
+            std::memcpy(&tile[row * tileRowBytes], &band.rgb[3 * ((size_t)row * width + x0)], rowBytes);
+        }
+        file.write(reinterpret_cast<const char*>(tile.data()), (std::streamsize)tile.size());
+    }
+    ++bandsWritten;
+    return (bool)file;
+}
+
+void TiledTiffWriter::putEntry(uint16_t tag, uint16_t type, uint64_t count, uint64_t value) {
+    putLittleEndian(directory, tag, 2);
+    putLittleEndian(directory, type, 2);
+    putLittleEndian(directory, count, 8);
+    putLittleEndian(directory, value, 8);  // value (left-justified) or offset
+}
+
+bool TiledTiffWriter::finish() {
+    if (bandsWritten != tilesDown) return false;
+
+    const uint64_t tileCount = (uint64_t)tilesAcross * tilesDown;
+    const uint64_t tileBytes = tile.size();
+    const uint64_t directoryOffset = HEADER_SIZE + tileCount * tileBytes;
+    const uint64_t directorySize = 8 + ENTRY_COUNT * 20 + 8;
+    const uint64_t offsetsOffset = directoryOffset + directorySize;
+    const uint64_t countsOffset = offsetsOffset + 8 * tileCount;
+
+    // A single tile's offset and byte count fit in the entry itself
+    const bool inlineArrays = tileCount == 1;
+    directory.clear();
+    putLittleEndian(directory, ENTRY_COUNT, 8);
+    putEntry(TAG_IMAGE_WIDTH, TYPE_LONG, 1, (uint64_t)width);
+    putEntry(TAG_IMAGE_LENGTH, TYPE_LONG, 1, (uint64_t)height);
+    putEntry(TAG_BITS_PER_SAMPLE, TYPE_SHORT, 3, 8 | (8ull << 16) | (8ull << 32));
+    putEntry(TAG_COMPRESSION, TYPE_SHORT, 1, 1);        // none
+    putEntry(TAG_PHOTOMETRIC, TYPE_SHORT, 1, 2);        // RGB
+    putEntry(TAG_SAMPLES_PER_PIXEL, TYPE_SHORT, 1, 3);
+    putEntry(TAG_PLANAR_CONFIG, TYPE_SHORT, 1, 1);      // interleaved
+    putEntry(TAG_TILE_WIDTH, TYPE_LONG, 1, (uint64_t)tileSize);
+    putEntry(TAG_TILE_LENGTH, TYPE_LONG, 1, (uint64_t)tileSize);
+    putEntry(TAG_TILE_OFFSETS, TYPE_LONG8, tileCount, inlineArrays ? HEADER_SIZE : offsetsOffset);
+    putEntry(TAG_TILE_BYTE_COUNTS, TYPE_LONG8, tileCount, inlineArrays ? tileBytes : countsOffset);
+    putLittleEndian(directory, 0, 8);  // no further directory
+    file.write(reinterpret_cast<const char*>(directory.data()), (std::streamsize)directory.size());
+
+    // Tile offsets, then byte counts, in chunks
+    if (!inlineArrays) {
+        for (int pass = 0; pass < 2; ++pass) {
+            directory.clear();
+            for (uint64_t i = 0; i < tileCount; ++i) {
+                putLittleEndian(directory, pass == 0 ? HEADER_SIZE + i * tileBytes : tileBytes, 8);
+                if (directory.size() >= 65536 || i + 1 == tileCount) {
+                    file.write(reinterpret_cast<const char*>(directory.data()), (std::streamsize)directory.size());
+                    directory.clear();
+                }
+            }
+        }
+    }
+    file.close();
+    return !file.fail();
+}
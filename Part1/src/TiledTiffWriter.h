@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ImageWriter.h"
+
+// Streams an 8-bit RGB image of any size into a tiled BigTIFF file, one band
+// of tile rows at a time, so the whole image never has to be in memory.
+// Tiles are uncompressed and tileSize x tileSize (edge tiles padded with
+// black, as TIFF requires). They are written in file order as bands arrive;
+// the directory with the tile offsets follows the pixel data, so the file is
+// written front to back without seeking. BigTIFF's 64-bit offsets allow
+// files past 4 GB (a 100k x 100k image is about 30 GB).
+class TiledTiffWriter {
+public:
+    // tileSize must be a positive multiple of 16 (a TIFF rule)
+    TiledTiffWriter(int width, int height, int tileSize);
+
+    // Create the file and write the header; false on I/O errors
+    bool open(const std::string& path);
+
+    // Append the next band: an image of the full width and tileSize rows
+    // (fewer for the last band). Returns false on I/O errors.
+    bool writeBand(const ImageBuffer& band);
+
+    // Write the directory after the last band and close; false on I/O errors
+    // or if bands are missing.
+    bool finish();
+
+    int getTileSize() const { return tileSize; }
+    int getBandCount() const { return tilesDown; }
+
+private:
+    void putEntry(uint16_t tag, uint16_t type, uint64_t count, uint64_t value);
+
+    const int width;
+    const int height;
+    const int tileSize;
+    const int tilesAcross;
+    const int tilesDown;
+    int bandsWritten = 0;
+    std::ofstream file;
+    std::vector<unsigned char> tile;      // one padded tile
+    std::vector<unsigned char> directory; // IFD being assembled
+};
@@ -1,530 +1,467 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
-#include <cmath>
-#include <limits>
 #include <algorithm>
-
-#include "Illumination.h"
-#include "GlobalLight.h"
-#include "ConeLight.h"
-#include "ParallelLight.h"
-#include "Primitive.h"
-#include "Sphere.h"
-#include "Plane.h"
-#include "RayCast.h"
-#include "HitResult.h"
-
-#include "stb/stb_image_write.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ThreadPool.h"
+#include "SceneSnapshot.h"
+#include "SphereBlock.h"
+#include "PngEncoder.h"
+#include "ImageWriter.h"
+#include "BoundedQueue.h"
+#include "Renderer.h"
+#include "RenderDaemon.h"
+#include "TileFarm.h"
+#include "TiledTiffWriter.h"
 
 using namespace std;
 
-// ============================================================================
-// GLOBAL STATE: Viewport/Camera Configuration
-// ============================================================================
-
-Vec3 eyePosition;      // Camera/eye position in world space
-Vec3 forwardDir;        // Forward direction vector (normalized)
-Vec3 up;                // Up direction vector (normalized)
-Vec3 rightDir;          // Right direction vector (normalized)
-float focalLength = 0;   // Distance from eye to viewport plane
-float viewportHeight = 0;// Height of viewport in world units
-float viewportWidth = 0; // Width of viewport in world units
+// Render options set from the command line
+struct RenderSettings {
+    unsigned threadCount = 0;     // 0 = one per hardware thread
+    bool packetTracing = false;   // trace primary rays in RayPacket::DIM^2 packets
+    int maxDepth = DEFAULT_MAX_DEPTH; // reflection/refraction bounces after the primary hit
+    bool wavefront = false;       // trace tiles in waves sorted by material
+    int pngLevel = PngEncoder::DEFAULT_LEVEL;  // PNG compression level (0 = stored)
+    string outputFormat = "png";  // ImageWriter format name
+    string outputPath;            // explicit output file (single scene), format from its extension
+    unsigned concurrentScenes = 0; // scenes rendered at the same time (0 = 2 with several threads)
+    string daemonSocket;          // serve render requests on this Unix socket instead (RenderDaemon)
+    size_t cacheSize = 16;        // daemon: compiled scenes kept warm
+    int width = 800;              // output image size
+    int height = 800;
+    FarmSettings farm;            // used when farm.workers > 0 (TileFarm)
+    bool tileWorker = false;      // run as a TileFarm worker on stdin/stdout
+    int tiffTileSize = 256;       // tif output: tile edge (multiple of 16)
+    bool streamOutput = true;     // png/ppm: encode bands while rendering, no full framebuffer
+    bool printStats = false;      // report shadow ray and occluder cache counts per scene
+};
+
+// Rows per band when streaming output (a multiple of the render tile size)
+const int STREAM_BAND_ROWS = 64;
 
 // ============================================================================
-// HELPER FUNCTIONS
+// IMAGE OUTPUT
 // ============================================================================
 
-// Reset viewport to default configuration
-// Implemented as stated in the PDF: Phase 1 camera defaults match the PDF (screen corners ±1)
-void resetCamera() {
-    eyePosition = Vec3(0, 0, 1);      // 1 unit in front of the Z=0 screen
-    forwardDir  = Vec3(0, 0, -1);     // looks toward the screen
-    up          = Vec3(0, 1, 0);
-    rightDir    = Vec3(1, 0, 0);
-
-    focalLength     = 1.0f;           // screen at Z=0 from eye at Z=1
-    viewportHeight  = 2.0f;           // from -1 to 1
-    viewportWidth   = 2.0f;           // from -1 to 1
+// Save image buffer in the writer's format
+static bool saveImage(const std::string& filename, const ImageBuffer& image, const ImageWriter& writer) {
+    return writer.write(filename, image);
 }
 
-// Check if point is finite (not infinity)
-static bool isFinitePoint(const Vec3& pt) {
-    return !(std::isinf(pt.x) || std::isinf(pt.y) || std::isinf(pt.z));
-}
+// ============================================================================
+// BATCH PIPELINE
+// ============================================================================
 
-// Forward declarations
-bool isOccluded(const Vec3& pt, const Vec3& lightDirection, const float lightDistance, 
-                const std::vector<Primitive*>& objects);
-
-// Calculate light direction and distance for a given light source
-// Returns true if light is valid (not blocked by cone angle), false otherwise
-static bool calculateLightDirection(Illumination* illum, const Vec3& pt, Vec3& outDirection, float& outDistance) {
-    if (illum->isConeType()) {
-        auto* cone = dynamic_cast<ConeLight*>(illum);
-        Vec3 toLight = cone->getPosition() - pt;
-        outDistance = glm::length(toLight);
-        outDirection = glm::normalize(toLight);
-        
-        // Check if point is within cone angle
-        Vec3 coneDirection = glm::normalize(cone->getDirection());
-        float cosAngle = glm::dot(-outDirection, coneDirection);
-        if (cosAngle < cone->getAngle()) return false;  // Outside cone
-    } else {
-        outDirection = glm::normalize(-illum->getDirection());
-        outDistance = std::numeric_limits<float>::infinity();
-    }
-    return true;
+// Scene handed from the load stage to the render stage
+struct LoadedScene {
+    string path;
+    std::unique_ptr<SceneSnapshot> scene;
+};
+
+// Image handed from the render stage to the write stage
+struct RenderedScene {
+    string path;
+    std::unique_ptr<ImageBuffer> image;
+};
+
+// Print one whole line; stages run on different threads
+static void logLine(const string& line, bool error = false) {
+    static std::mutex logLock;
+    std::lock_guard<std::mutex> guard(logLock);
+    (error ? cerr : cout) << line << endl;
 }
 
-// Calculate specular highlight for glass surfaces
-static Vec3 calculateGlassSpecular(Primitive* obj, const Vec3& pt, const Vec3& normal, 
-                                   const Vec3& viewDir, Illumination* illum, 
-                                   const Vec3& lightDir, const std::vector<Primitive*>& objects) {
-    if (isOccluded(pt, lightDir, std::numeric_limits<float>::infinity(), objects)) {
-        return Vec3(0, 0, 0);
-    }
-    
-    Vec3 reflectionDir = glm::normalize(glm::reflect(-lightDir, normal));
-    float specularAngle = glm::max(glm::dot(reflectionDir, viewDir), 0.0f);
-    float specularPower = glm::pow(specularAngle, obj->get_shininess());
-    return Vec3(1, 1, 1) * specularPower * illum->getColor();
+// One-line summary of a render's counters
+static string statsLine(const string& path, const RenderStats& stats) {
+    const uint64_t lookups = stats.occluderLookups, hits = stats.occluderHits;
+    return "Stats: " + path + ": " + std::to_string(stats.shadowRays.load()) + " shadow rays, occluder cache hits " +
+           std::to_string(hits) + " of " + std::to_string(lookups) + " lookups (" +
+           std::to_string(lookups ? 100 * hits / lookups : 0) + "%)";
 }
 
-// ============================================================================
-// SCENE PARSING
-// ============================================================================
-
-// Parse and execute a single command from scene file
-void handleCommand(const string& line, vector<Illumination*>& illuminators, 
-                   vector<Primitive*>& objects, Vec3& ambientLight) {
-    stringstream ss(line);
-    char cmd;
-    ss >> cmd;
-    vector<float> values;
-    float val;
-    while (ss >> val) values.push_back(val);
-
-    switch (cmd) {
-    case 'e':  // Eye position
-        eyePosition = glm::vec3(values[0], values[1], values[2]); 
-        if (values.size() > 3) focalLength = values[3]; 
-        break;
-    case 'u':  // Up vector
-        up = glm::vec3(values[0], values[1], values[2]); 
-        if (values.size() > 3) viewportHeight = values[3]; 
-        break;
-    case 'f':  // Forward direction
-        forwardDir = glm::vec3(values[0], values[1], values[2]); 
-        // Implemented as stated in the PDF: use the scene's screen width from f ... w (4th value)
-        if (values.size() > 3) viewportWidth = values[3];
-        break;
-    case 'a':  // Ambient light color
-        ambientLight = Vec3(values[0], values[1], values[2]); 
-        break;
-    case 'd':  // Directional or cone light
-        if(values[3] == 0.0f) 
-            illuminators.push_back(new ParallelLight(glm::vec3(values[0], values[1], values[2])));
-        else 
-            illuminators.push_back(new ConeLight(glm::vec3(values[0], values[1], values[2])));
-        break;
-    case 'p':  // Cone light position and angle
-        for(Illumination* illum : illuminators) {
-            if(illum->isConeType()) {
-                auto* cone = dynamic_cast<ConeLight*>(illum);
-                if(cone->getAngle() == -1.0f) {
-                   cone->setAngle(values[3]); 
-                   cone->setPosition(glm::vec3(values[0], values[1], values[2])); 
-                   break;
-                }
+// Render a list of scenes as a three-stage pipeline joined by bounded queues:
+//   load   (settings.concurrentScenes) parse and compile, or map a .rtsb file
+//   render (settings.concurrentScenes) trace on the pool, tile-parallel
+//   write  (1 thread)                  encode and save (PNG strips also use the pool)
+// so scene N+1 is loaded and scene N-1 is written while scene N renders. The
+// queues hold at most a few scenes, which bounds memory for long batches.
+// Formats that stream (png, ppm) skip the write stage: each render streams
+// its bands to the encoder (renderBands), so no full framebuffer exists.
+// Parsing keeps no global state, so several scenes can load at once.
+// Returns the number of scenes that could not be loaded or written.
+int renderBatch(const vector<string>& scenes, ThreadPool& pool, const RenderSettings& settings,
+                const ImageWriter& writer) {
+    const int width = settings.width, height = settings.height;
+    const bool streamed = settings.streamOutput && writer.canStream();
+    const unsigned renderers = std::max(1u, settings.concurrentScenes);
+    BoundedQueue<LoadedScene> loaded(renderers);
+    BoundedQueue<RenderedScene> rendered(2);
+    std::atomic<int> failures{0};
+    std::atomic<size_t> nextScene{0};
+    std::atomic<unsigned> activeLoaders{renderers};
+
+    auto loadScenes = [&] {
+        for (size_t i = nextScene++; i < scenes.size(); i = nextScene++) {
+            const string& filepath = scenes[i];
+            logLine("Loading: " + filepath);
+            string error;
+            std::unique_ptr<SceneSnapshot> scene(loadScene(filepath, error));
+            if (!scene) {
+                logLine(error, true);
+                ++failures;
+                continue;
             }
+            loaded.push({filepath, std::move(scene)});
         }
-        break;
-    case 'i':  // Light intensity/color
-        for(Illumination* illum : illuminators) {
-            if(!illum->isGlobalType() && !illum->isColorSet()){ 
-                illum->setColor(values[0], values[1], values[2]); 
-                break; 
-            }    
-        }
-        break;
-    case 'o': case 'r': case 't':  // Object (standard/mirror/glass)
-        {
-            MaterialType matType = (cmd == 'o') ? STANDARD : (cmd == 'r') ? MIRROR : GLASS;
-            if(values[3] > 0) 
-                objects.push_back(new Sphere(glm::vec3(values[0], values[1], values[2]), values[3], matType));
-            else 
-                objects.push_back(new Plane(glm::vec3(values[0], values[1], values[2]), values[3], matType));
+        if (--activeLoaders == 0) loaded.close();
+    };
+    vector<std::thread> loaders;
+    for (unsigned i = 0; i < renderers; ++i) loaders.emplace_back(loadScenes);
+
+    std::thread saver([&] {
+        RenderedScene item;
+        while (rendered.pop(item)) {
+            string outputFile = settings.outputPath.empty() ? ImageWriter::outputPathFor(item.path, writer.getExtension())
+                                                            : settings.outputPath;
+            if (!saveImage(outputFile, *item.image, writer)) {
+                logLine("Failed to write " + outputFile, true);
+                ++failures;
+                continue;
+            }
+            logLine("Saved: " + outputFile);
         }
-        break;
-    case 'c':  // Color for object
-        for(Primitive* obj : objects) {
-            if(!obj->is_rgb_set()) { 
-                obj->set_rgb(values[0], values[1], values[2], values[3]); 
-                break; 
+    });
+
+    auto renderScenes = [&] {
+        LoadedScene item;
+        while (loaded.pop(item)) {
+            logLine("Rendering: " + item.path);
+            RenderContext context(*item.scene, item.scene->getCamera(), width, height, settings.packetTracing,
+                                  settings.maxDepth, settings.wavefront);
+            RenderStats stats;
+            if (settings.printStats) context.stats = &stats;
+            if (streamed) {
+                string outputFile = settings.outputPath.empty() ? ImageWriter::outputPathFor(item.path, writer.getExtension())
+                                                                : settings.outputPath;
+                std::unique_ptr<ImageStream> stream = writer.openStream(outputFile, width, height);
+                bool written = stream && renderBands(context, STREAM_BAND_ROWS, writer.needsRadiance(), pool,
+                                                     [&](const ImageBuffer& band) { return stream->writeRows(band); });
+                if (settings.printStats) logLine(statsLine(item.path, stats));
+                if (!stream || !stream->finish() || !written) {
+                    logLine("Failed to write " + outputFile, true);
+                    ++failures;
+                    continue;
+                }
+                logLine("Saved: " + outputFile);
+                continue;
             }
+            std::unique_ptr<ImageBuffer> image(new ImageBuffer(width, height, writer.needsRadiance()));
+            renderImage(context, *image, pool);
+            if (settings.printStats) logLine(statsLine(item.path, stats));
+            item.scene.reset();
+            rendered.push({item.path, std::move(image)});
         }
-        break;
-    default: break;
-    }
-}
-
-// Read and parse entire scene file
-int readScene(const string& filename, vector<Illumination*>& illuminators, 
-              vector<Primitive*>& objects, Vec3& ambientLight) {
-    ifstream file(filename);
-    if (!file.is_open()) return -1;
-    string line;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        handleCommand(line, illuminators, objects, ambientLight);
-    }
-    return 0;
+    };
+    vector<std::thread> extraRenderers;
+    for (unsigned i = 1; i < renderers; ++i) extraRenderers.emplace_back(renderScenes);
+    renderScenes();
+    for (std::thread& renderer : extraRenderers) renderer.join();
+
+    rendered.close();
+    for (std::thread& loader : loaders) loader.join();
+    saver.join();
+    return failures.load();
 }
 
 // ============================================================================
-// CAMERA/VIEWPORT SETUP
+// MAIN ENTRY POINT
 // ============================================================================
 
-// Configure viewport coordinate system based on image dimensions
-// Implemented as stated in the PDF: only auto-compute width if it wasn't provided from 'f' command
-void configureViewport(int width, int height) {
-    forwardDir = glm::normalize(forwardDir);
-    up = glm::normalize(up);
-    rightDir = glm::normalize(glm::cross(forwardDir, up));
-    float aspect = (float)width / height;
-    if (viewportWidth == 0.0f) {
-        viewportWidth = viewportHeight * aspect;
+// Compile a text scene and save it as .rtsb
+static bool convertScene(const string& input, const string& output) {
+    string error;
+    SceneSnapshot* scene = loadScene(input, error);
+    if (!scene) {
+        cerr << error << endl;
+        return false;
     }
-}
-
-// Create ray from camera through pixel at (px, py)
-RayCast generateRay(int px, int py, int width, int height) {
-    Vec3 viewportCenter = eyePosition + (forwardDir * focalLength);
-    float u = (px + 0.5f) / width - 0.5f;   // Normalized x coordinate [-0.5, 0.5]
-    float v = 0.5f - (py + 0.5f) / height;  // Normalized y coordinate [-0.5, 0.5]
-    Vec3 pixelLocation = viewportCenter + (rightDir * (u * viewportWidth)) + (up * (v * viewportHeight));
-    Vec3 rayDirection = glm::normalize(pixelLocation - eyePosition);
-    return RayCast(eyePosition, rayDirection);
-}
-
-// ============================================================================
-// RAY-OBJECT INTERSECTION
-// ============================================================================
-
-// Find closest intersection with scene objects
-static bool closestHit(const RayCast& ray, const std::vector<Primitive*>& objects, 
-                       const Vec3& rayOrigin, Primitive*& hitObject, Vec3& hitPoint) {
-    float closestDistance = std::numeric_limits<float>::infinity();
-    hitObject = nullptr;
-    for (Primitive* obj : objects) {
-        Vec3 intersection = obj->get_intersection(ray);
-        if (!isFinitePoint(intersection)) continue;
-        float distance = glm::length(intersection - rayOrigin);
-        if (distance > 0.001f && distance < closestDistance) { 
-            closestDistance = distance; 
-            hitObject = obj; 
-            hitPoint = intersection; 
-        }
+    bool saved = scene->save(output);
+    delete scene;
+    if (!saved) {
+        cerr << "Failed to write " << output << endl;
+        return false;
     }
-    return hitObject != nullptr;
+    cout << "Converted " << input << " -> " << output << endl;
+    return true;
 }
 
-// Check if point is occluded from light source (shadow test)
-bool isOccluded(const Vec3& pt, const Vec3& lightDirection, const float lightDistance, 
-                const std::vector<Primitive*>& objects) {
-    RayCast occlusionRay(pt + lightDirection * 0.01f, lightDirection); 
-    for (Primitive* obj : objects) {
-        Vec3 intersection = obj->get_intersection(occlusionRay);
-        if (isFinitePoint(intersection)) {
-            float distance = glm::length(intersection - pt);
-            if (distance < lightDistance) return true; 
+// Render each scene across worker processes, one frame at a time
+// Returns the number of scenes that could not be rendered or written.
+static int renderFarm(const vector<string>& scenes, const RenderSettings& settings, const ImageWriter& writer) {
+    TileFarm farm(settings.farm);
+    int failures = 0;
+    for (const string& filepath : scenes) {
+        cout << "Rendering on " << settings.farm.workers << " workers: " << filepath << endl;
+        ImageBuffer image(settings.width, settings.height, writer.needsRadiance());
+        string error;
+        if (!farm.render(filepath, image, error)) {
+            cerr << "Failed to render " << filepath << ": " << error << endl;
+            ++failures;
+            continue;
         }
+        string outputFile = settings.outputPath.empty() ? ImageWriter::outputPathFor(filepath, writer.getExtension())
+                                                        : settings.outputPath;
+        if (!saveImage(outputFile, image, writer)) {
+            cerr << "Failed to write " << outputFile << endl;
+            ++failures;
+            continue;
+        }
+        cout << "Saved: " << outputFile << endl;
     }
-    return false;
-}
-
-// ============================================================================
-// SHADING AND COLOR
-// ============================================================================
-
-// Sample checkerboard pattern for planes
-Vec3 samplePattern(Vec3 baseColor, Vec3 pt, Vec3 n) {
-    const float tileSize = 0.5f;
-    float patternValue = 0;
-    
-    // Calculate pattern based on x and y coordinates
-    if (pt.x < 0) {
-        patternValue += floor((0.5 - pt.x) / tileSize);
-    } else {
-        patternValue += floor(pt.x / tileSize);
-    }
-    if (pt.y < 0) {
-        patternValue += floor((0.5 - pt.y) / tileSize);
-    } else {
-        patternValue += floor(pt.y / tileSize);
-    }
-    patternValue = (patternValue * 0.5) - int(patternValue * 0.5);
-    patternValue *= 2;
-
-    // Return darker or lighter based on pattern
-    return (patternValue > 0.5) ? (0.5f * baseColor) : baseColor;
-}
-
-// Get object color (with checkerboard pattern for planes)
-Vec3 sampleColor(Primitive* obj, const Vec3& pt) {
-    if (dynamic_cast<Plane*>(obj)) {
-        return samplePattern(obj->get_rgb(), pt, obj->get_normal(pt));
-    }
-    return obj->get_rgb();
+    return failures;
 }
 
-// Returns 1.0 for bright tiles and 0.5 for dark tiles (planes only)
-// Implemented as stated in the PDF: checkerboard affects diffuse only, not ambient
-float checkerCoeff(Primitive* obj, const Vec3& pt) {
-    if (!dynamic_cast<Plane*>(obj)) return 1.0f;
-
-    const float tileSize = 0.5f;
-    float patternValue = 0;
-
-    if (pt.x < 0) patternValue += floor((0.5f - pt.x) / tileSize);
-    else          patternValue += floor(pt.x / tileSize);
-
-    if (pt.y < 0) patternValue += floor((0.5f - pt.y) / tileSize);
-    else          patternValue += floor(pt.y / tileSize);
-
-    patternValue = (patternValue * 0.5f) - int(patternValue * 0.5f);
-    patternValue *= 2.0f;
-
-    return (patternValue > 0.5f) ? 0.5f : 1.0f;
+// Whether format names the out-of-core tiled TIFF output
+static bool isTiledFormat(string format) {
+    std::transform(format.begin(), format.end(), format.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return format == "tif" || format == "tiff";
 }
 
-// Calculate Lambertian diffuse shading component
-// Implemented as stated in the PDF: checkerboard affects diffuse only
-glm::vec3 lambertianShading(Primitive* obj, const glm::vec3& pt, Illumination* illum, 
-                            const glm::vec3& lightDirection) {
-    glm::vec3 normal = glm::normalize(obj->get_normal(pt));
-    float nDotL = glm::max(glm::dot(normal, lightDirection), 0.0f);
-    Vec3 kd = obj->get_rgb() * checkerCoeff(obj, pt);
-    return kd * nDotL * illum->getColor();
-}
+// Render each scene one band of TIFF tiles at a time and stream the bands to
+// a tiled TIFF, so memory stays at a few bands whatever the image size
+// (a band is width x tile size pixels: ~77 MB for a 100k-wide image with
+// 256-pixel tiles). The next band renders while the previous one is written
+// (renderBands).
+// Returns the number of scenes that could not be rendered or written.
+static int renderTiled(const vector<string>& scenes, ThreadPool& pool, const RenderSettings& settings) {
+    int failures = 0;
+    for (const string& filepath : scenes) {
+        cout << "Loading: " << filepath << endl;
+        string error;
+        std::unique_ptr<SceneSnapshot> scene(loadScene(filepath, error));
+        if (!scene) {
+            cerr << error << endl;
+            ++failures;
+            continue;
+        }
 
-// Calculate Phong specular highlight component
-glm::vec3 phongHighlight(Primitive* obj, const glm::vec3& pt, const glm::vec3& eyePos, 
-                          Illumination* illum, const glm::vec3& lightDirection) {
-    glm::vec3 normal = glm::normalize(obj->get_normal(pt));
-    glm::vec3 viewDirection = glm::normalize(eyePos - pt);
-    glm::vec3 reflectionDirection = glm::normalize(glm::reflect(-lightDirection, normal));
-    float viewDotReflect = glm::max(glm::dot(viewDirection, reflectionDirection), 0.0f);
-    float specularPower = glm::pow(viewDotReflect, obj->get_shininess());
-    glm::vec3 specularColor(0.7f, 0.7f, 0.7f);
-    return specularColor * specularPower * illum->getColor();
-}
+        string outputFile = settings.outputPath.empty() ? ImageWriter::outputPathFor(filepath, "tif") : settings.outputPath;
+        TiledTiffWriter tiff(settings.width, settings.height, settings.tiffTileSize);
+        if (!tiff.open(outputFile)) {
+            cerr << "Failed to write " << outputFile << endl;
+            ++failures;
+            continue;
+        }
 
-// Calculate total illumination at point (ambient + diffuse + specular)
-// Implemented as stated in the PDF: ambient uses base color only (checkerboard does not affect ambient)
-Vec3 calculateIllumination(Primitive* obj, const Vec3& pt, const Vec3& eyePos, 
-                           const Vec3& ambient, const std::vector<Illumination*>& illuminators, 
-                           const std::vector<Primitive*>& objects) {
-    Vec3 finalColor = obj->get_rgb() * ambient; 
-    for (Illumination* illum : illuminators) {
-        if (illum->isGlobalType()) continue;
-        
-        Vec3 lightDirection;
-        float lightDistance;
-        if (!calculateLightDirection(illum, pt, lightDirection, lightDistance)) continue;
-        if (isOccluded(pt, lightDirection, lightDistance, objects)) continue;
-        
-        finalColor += lambertianShading(obj, pt, illum, lightDirection);
-        finalColor += phongHighlight(obj, pt, eyePos, illum, lightDirection);
+        cout << "Rendering " << settings.width << "x" << settings.height << " in " << tiff.getBandCount()
+             << " bands: " << filepath << endl;
+        RenderContext context(*scene, scene->getCamera(), settings.width, settings.height, settings.packetTracing,
+                              settings.maxDepth, settings.wavefront);
+        RenderStats stats;
+        if (settings.printStats) context.stats = &stats;
+        int band = 0, reported = 0;
+        bool written = renderBands(context, tiff.getTileSize(), false, pool, [&](const ImageBuffer& pixels) {
+            const int percent = 100 * ++band / tiff.getBandCount();
+            if (percent / 10 > reported / 10) {
+                cout << "  " << percent << "%" << endl;
+                reported = percent;
+            }
+            return tiff.writeBand(pixels);
+        });
+        if (settings.printStats) cout << statsLine(filepath, stats) << endl;
+
+        if (!written || !tiff.finish()) {
+            cerr << "Failed to write " << outputFile << endl;
+            ++failures;
+            continue;
+        }
+        cout << "Saved: " << outputFile << endl;
     }
-    return finalColor;
-}
-
-// ============================================================================
-// RAY TRACING
-// ============================================================================
-
-// Forward declaration
-Vec3 traceRay(const RayCast& ray, const std::vector<Primitive*>& objects, 
-              const std::vector<Illumination*>& illuminators, const Vec3& ambient, int bounceCount);
-
-// Handle reflection: calculate reflected ray and trace recursively
-static Vec3 handleReflection(Primitive* obj, const Vec3& hitPoint, const RayCast& ray,
-                              const std::vector<Primitive*>& objects,
-                              const std::vector<Illumination*>& illuminators,
-                              const Vec3& ambient, int bounceCount) {
-    Vec3 normal = obj->get_normal(hitPoint);
-    Vec3 rayDirection = ray.getDirection();
-    Vec3 reflectionDirection = glm::reflect(rayDirection, normal);
-    RayCast reflectedRay(hitPoint + reflectionDirection * 0.001f, reflectionDirection);
-    return traceRay(reflectedRay, objects, illuminators, ambient, bounceCount + 1);
+    return failures;
 }
 
-// Handle refraction: calculate refracted ray through glass and trace recursively
-static Vec3 handleRefraction(Primitive* obj, const Vec3& hitPoint, const RayCast& ray,
-                              const std::vector<Primitive*>& objects,
-                              const std::vector<Illumination*>& illuminators,
-                              const Vec3& ambient, int bounceCount) {
-    Vec3 normal = obj->get_normal(hitPoint);
-    Vec3 rayDirection = ray.getDirection();
-    
-    // Entering: Air (n1=1.0) to Glass (n2=1.5)
-    const float n1 = 1.0f, n2 = 1.5f; 
-    float eta = n1 / n2;
-    Vec3 refractedIn = glm::refract(rayDirection, normal, eta);
-    
-    // Total internal reflection: use reflection instead
-    if (glm::length(refractedIn) < 0.01f) {
-        refractedIn = glm::reflect(rayDirection, normal); 
-    }
-
-    // Find exit point by tracing through object
-    RayCast internalRay(hitPoint + refractedIn * 0.01f, refractedIn);
-    Vec3 exitPoint = obj->get_intersection(internalRay);
-    
-    Vec3 refractedColor(0, 0, 0);
-    
-    if (isFinitePoint(exitPoint)) {
-        // Exiting: Glass (n2=1.5) to Air (n1=1.0)
-        Vec3 exitNormal = obj->get_normal(exitPoint);
-        Vec3 exitNormalInv = -exitNormal;
-        
-        eta = n2 / n1;
-        Vec3 refractedOut = glm::refract(refractedIn, exitNormalInv, eta);
-        
-        if (glm::length(refractedOut) < 0.01f) refractedOut = refractedIn;
-
-        RayCast exitRay(exitPoint + refractedOut * 0.01f, refractedOut);
-        refractedColor = traceRay(exitRay, objects, illuminators, ambient, bounceCount + 1);
-    }
-
-    // Implemented as stated in the PDF: transparent objects use refracted color only (ignore material lighting)
-    return refractedColor; 
+// Quote text for /bin/sh
+static string shellQuote(const string& text) {
+    string quoted = "'";
+    for (char c : text) quoted += (c == '\'') ? string("'\\''") : string(1, c);
+    return quoted + "'";
 }
 
-// Recursive ray tracing: trace ray through scene and calculate color
-Vec3 traceRay(const RayCast& ray, const std::vector<Primitive*>& objects, 
-              const std::vector<Illumination*>& illuminators, const Vec3& ambient, int bounceCount) {
-    // Limit recursion depth to prevent infinite loops
-    if (bounceCount > 5) return Vec3(0, 0, 0); 
-    
-    Primitive* hitObject = nullptr;
-    Vec3 hitPoint;
-    
-    // Find closest intersection
-    if (!closestHit(ray, objects, ray.getOrigin(), hitObject, hitPoint)) {
-        return Vec3(0, 0, 0);  // No hit: return black
-    }
-
-    // Handle reflective surfaces
-    if (hitObject->is_reflective()) {
-        return handleReflection(hitObject, hitPoint, ray, objects, illuminators, ambient, bounceCount);
-    }
-
-    // Handle transparent surfaces (refraction)
-    if (hitObject->is_transparent()) {
-        return handleRefraction(hitObject, hitPoint, ray, objects, illuminators, ambient, bounceCount);
+// Serve render requests until a client sends shutdown
+static int runDaemon(const RenderSettings& settings) {
+    ThreadPool pool(settings.threadCount);
+    DaemonSettings daemonSettings;
+    daemonSettings.socketPath = settings.daemonSocket;
+    daemonSettings.cacheCapacity = settings.cacheSize;
+    daemonSettings.workers = settings.concurrentScenes > 0 ? settings.concurrentScenes
+                                                           : (pool.getThreadCount() > 1 ? 2 : 1);
+    daemonSettings.pngLevel = settings.pngLevel;
+    daemonSettings.packetTracing = settings.packetTracing;
+    daemonSettings.maxDepth = settings.maxDepth;
+    daemonSettings.wavefront = settings.wavefront;
+
+    RenderDaemon daemon(pool, daemonSettings);
+    cout << "Render threads: " << pool.getThreadCount() << endl;
+    cout << "Listening on " << settings.daemonSocket << endl;
+    string error;
+    if (!daemon.run(error)) {
+        cerr << error << endl;
+        return 1;
     }
-
-    // Standard material: calculate lighting
-    return calculateIllumination(hitObject, hitPoint, ray.getOrigin(), ambient, illuminators, objects);
+    cout << "Daemon stopped" << endl;
+    return 0;
 }
 
-// ============================================================================
-// IMAGE OUTPUT
-// ============================================================================
-
-// Save image buffer to PNG file
-static bool savePNG(const std::string& filename, int width, int height, 
-                    const std::vector<unsigned char>& pixels) {
-    int stride = width * 3;
-    return stbi_write_png(filename.c_str(), width, height, 3, pixels.data(), stride) != 0;
+// Parse a whole decimal integer (no trailing characters)
+static bool parseInteger(const char* text, int& value) {
+    char rest;
+    return sscanf(text, "%d%c", &value, &rest) == 1;
 }
 
-// Build output file path from scene file path
-string buildOutputPath(const string& filepath) {
-    size_t lastSlash = filepath.find_last_of("/\\");
-    string filename = (lastSlash == string::npos) ? filepath : filepath.substr(lastSlash + 1);
-    size_t lastDot = filename.find_last_of(".");
-    if (lastDot != string::npos) {
-        filename = filename.substr(0, lastDot);
+// Parse the integer value of option, which must lie in [minimum, maximum];
+// prints an error and returns false otherwise
+static bool parseOptionValue(const string& option, const char* text, int minimum, int maximum, int& value) {
+    if (parseInteger(text, value) && value >= minimum && value <= maximum) return true;
+    cerr << option << " expects a whole number ";
+    if (maximum == INT_MAX) {
+        cerr << ">= " << minimum << endl;
+    } else {
+        cerr << "from " << minimum << " to " << maximum << endl;
     }
-    return "results/" + filename + ".png";
+    return false;
 }
 
-// ============================================================================
-// RENDERING
-// ============================================================================
-
-// Render single scene to image buffer
-void renderImage(int width, int height, const std::vector<Primitive*>& objects,
-                 const std::vector<Illumination*>& illuminators, const Vec3& ambientLight,
-                 std::vector<unsigned char>& image) {
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            RayCast ray = generateRay(x, y, width, height);
-            Vec3 color = traceRay(ray, objects, illuminators, ambientLight, 0);
-            color = glm::clamp(color, Vec3(0.0f), Vec3(1.0f));
-            
-            int pixelIdx = 3 * (y * width + x);
-            image[pixelIdx]     = (unsigned char)(255 * color.x);
-            image[pixelIdx + 1] = (unsigned char)(255 * color.y);
-            image[pixelIdx + 2] = (unsigned char)(255 * color.z);
+// Parse command line options
+// -j N / --threads N : number of render threads (0 = one per hardware thread)
+// --packets          : trace primary rays in 4x4 packets
+// --max-depth N      : reflection/refraction bounces after the primary hit (default 5)
+// --wavefront        : trace each tile in waves of rays sorted by material
+// --png-level N      : PNG compression level, 0 (stored) to 9 (smallest)
+// --format F         : output format: png, ppm, qoi, rgba or f32 (see ImageWriter.h)
+// -o FILE            : output file for a single scene; the format comes from its extension
+// --concurrent-scenes N : scenes rendered at the same time (default: 2 with several threads)
+// --convert IN OUT   : compile text scene IN into the binary scene OUT (.rtsb) and exit
+// --daemon SOCKET    : serve render requests on a Unix domain socket (see RenderDaemon.h)
+// --cache-size N     : daemon: compiled scenes kept warm (default 16)
+// --size WxH         : output image size (default 800x800)
+// --farm N           : render each scene on N worker processes (see TileFarm.h)
+// --farm-command CMD : shell command starting one worker (default: this program with --tile-worker)
+// --farm-tile N      : farm lease size in pixels (default 256)
+// --lease-timeout S  : seconds before an unanswered lease is issued again (default 120)
+// --tile-worker      : run as a farm worker on stdin/stdout
+// --tiff-tile N      : tile edge of tif output, a positive multiple of 16 (default 256)
+// --no-stream        : render png/ppm into a full framebuffer before encoding
+// --stats            : print shadow ray and occluder cache counts for each scene
+// other arguments    : scene files to render (.txt or .rtsb) instead of the default list
+static bool parseArguments(int argc, char* argv[], RenderSettings& settings,
+                           vector<string>& scenes, vector<pair<string, string>>& conversions) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        int value = 0;
+        if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 0, INT_MAX, value)) return false;
+            settings.threadCount = (unsigned)value;
+        } else if (arg == "--packets") {
+            settings.packetTracing = true;
+        } else if (arg == "--wavefront") {
+            settings.wavefront = true;
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            if (!parseInteger(argv[++i], settings.maxDepth) || settings.maxDepth < 0) {
+                cerr << "--max-depth expects a number of bounces >= 0" << endl;
+                return false;
+            }
+        } else if (arg == "--png-level" && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 0, 9, settings.pngLevel)) return false;
+        } else if (arg == "--format" && i + 1 < argc) {
+            settings.outputFormat = argv[++i];
+        } else if (arg == "--concurrent-scenes" && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 1, INT_MAX, value)) return false;
+            settings.concurrentScenes = (unsigned)value;
+        } else if (arg == "-o" && i + 1 < argc) {
+            settings.outputPath = argv[++i];
+            settings.outputFormat = ImageWriter::extensionOf(settings.outputPath);
+        } else if (arg == "--daemon" && i + 1 < argc) {
+            settings.daemonSocket = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 1, INT_MAX, value)) return false;
+            settings.cacheSize = (size_t)value;
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &settings.width, &settings.height) != 2 ||
+                settings.width <= 0 || settings.height <= 0) {
+                cerr << "--size expects WIDTHxHEIGHT" << endl;
+                return false;
+            }
+        } else if (arg == "--farm" && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 1, INT_MAX, value)) return false;
+            settings.farm.workers = (unsigned)value;
+        } else if (arg == "--farm-command" && i + 1 < argc) {
+            settings.farm.workerCommand = argv[++i];
+        } else if (arg == "--farm-tile" && i + 1 < argc) {
+            if (!parseOptionValue(arg, argv[++i], 1, INT_MAX, settings.farm.tileSize)) return false;
+        } else if (arg == "--lease-timeout" && i + 1 < argc) {
+            settings.farm.leaseTimeout = std::max(0.001, atof(argv[++i]));
+        } else if (arg == "--tiff-tile" && i + 1 < argc) {
+            if (!parseInteger(argv[++i], settings.tiffTileSize) || settings.tiffTileSize <= 0 ||
+                settings.tiffTileSize % 16 != 0) {
+                cerr << "--tiff-tile expects a positive multiple of 16" << endl;
+                return false;
+            }
+        } else if (arg == "--no-stream") {
+            settings.streamOutput = false;
+        } else if (arg == "--stats") {
+            settings.printStats = true;
+        } else if (arg == "--tile-worker") {
+            settings.tileWorker = true;
+        } else if (arg == "--convert" && i + 2 < argc) {
+            conversions.emplace_back(argv[i + 1], argv[i + 2]);
+            i += 2;
+        } else if (arg.empty() || arg[0] == '-') {
+            cerr << "Usage: " << argv[0] << " [-j threads] [--packets] [--max-depth N] [--wavefront]"
+                 << " [--png-level 0-9] [--format png|ppm|qoi|rgba|f32|tif] [-o file] [--concurrent-scenes N]"
+                 << " [--convert in.txt out.rtsb] [--daemon socket [--cache-size N]] [--size WxH]"
+                 << " [--farm N [--farm-command cmd] [--farm-tile N] [--lease-timeout s]] [--tile-worker]"
+                 << " [--tiff-tile N] [--no-stream] [--stats] [scene...]" << endl;
+            return false;
+        } else {
+            scenes.push_back(arg);
         }
     }
+    return true;
 }
 
-// Process single scene file: load, render, and save
-bool processScene(const string& filepath) {
-    cout << "--------------------------------------" << endl;
-    cout << "Processing: " << filepath << endl;
-    resetCamera(); 
-    
-    vector<Illumination*> illuminators;
-    vector<Primitive*> objects;
-    Vec3 ambientLight(0.0f, 0.0f, 0.0f);
-
-    // Load scene
-    if (readScene(filepath, illuminators, objects, ambientLight) != 0) {
-        cerr << "Failed to open: " << filepath << endl;
-        return false;
+int main(int argc, char* argv[])
+{
+    RenderSettings settings;
+    vector<string> scenes;
+    vector<pair<string, string>> conversions;
+    if (!parseArguments(argc, argv, settings, scenes, conversions)) return 1;
+
+    // Farm workers answer on stdout, so nothing else may be printed there
+    if (settings.tileWorker) {
+        ThreadPool pool(settings.threadCount);
+        return TileFarm::serve(pool);
     }
 
-    // Setup viewport
-    int width = 800, height = 800;
-    configureViewport(width, height);
-
-    // Render image
-    vector<unsigned char> image(3 * width * height, 0);
-    cout << "Rendering..." << endl;
-    renderImage(width, height, objects, illuminators, ambientLight, image);
-    
-    // Save image
-    string outputFile = buildOutputPath(filepath);
-    if (!savePNG(outputFile, width, height, image)) {
-        cerr << "Failed to write " << outputFile << endl;
-        return false;
+    if (!conversions.empty()) {
+        bool ok = true;
+        for (const auto& conversion : conversions) ok = convertScene(conversion.first, conversion.second) && ok;
+        return ok ? 0 : 1;
     }
-    cout << "Saved: " << outputFile << endl;
 
-    // Cleanup
-    for (Illumination* illum : illuminators) delete illum;
-    for (Primitive* obj : objects) delete obj;
-    
-    return true;
-}
-
-// ============================================================================
-// MAIN ENTRY POINT
-// ============================================================================
+    if (!settings.daemonSocket.empty()) return runDaemon(settings);
 
-int main()
-{
-    // List of scene files to render
-    vector<string> scenes = { 
+    // Default list of scene files to render
+    if (scenes.empty()) scenes = { 
         "res/scene1.txt", 
         "res/scene2.txt", 
         "res/scene3.txt",
@@ -536,11 +473,44 @@ int main()
         "res/scene51.txt"
     };
 
-    // Process each scene
-    for (const string& filepath : scenes) {
-        processScene(filepath);
+    if (!settings.outputPath.empty() && scenes.size() != 1) {
+        cerr << "-o needs exactly one scene file" << endl;
+        return 1;
+    }
+    if (settings.farm.workers > 0 && isTiledFormat(settings.outputFormat)) {
+        cerr << "--farm cannot write tif output (tiled renders run in this process)" << endl;
+        return 1;
+    }
+
+    ThreadPool pool(settings.threadCount);
+    const bool tiled = isTiledFormat(settings.outputFormat);
+    std::unique_ptr<ImageWriter> writer = ImageWriter::create(settings.outputFormat, pool, settings.pngLevel);
+    if (!writer && !tiled) {
+        cerr << "Unknown output format '" << settings.outputFormat << "' (png, ppm, qoi, rgba, f32, tif)" << endl;
+        return 1;
+    }
+    cout << "Render threads: " << pool.getThreadCount() << endl;
+    cout << "Sphere kernel: " << SphereBlock::kernelName() << endl;
+
+    // Overlap the tail of one scene's render with the next one when there are spare threads
+    if (settings.concurrentScenes == 0) settings.concurrentScenes = (pool.getThreadCount() > 1) ? 2 : 1;
+
+    int failures;
+    if (tiled) {
+        failures = renderTiled(scenes, pool, settings);
+    } else if (settings.farm.workers > 0) {
+        settings.farm.packetTracing = settings.packetTracing;
+        settings.farm.maxDepth = settings.maxDepth;
+        settings.farm.wavefront = settings.wavefront;
+        if (settings.farm.workerCommand.empty()) {
+            settings.farm.workerCommand = shellQuote(argv[0]) + " --tile-worker -j " + to_string(settings.threadCount);
+        }
+        failures = renderFarm(scenes, settings, *writer);
+    } else {
+        failures = renderBatch(scenes, pool, settings, *writer);
     }
     
     cout << "--------------------------------------" << endl;
-    return 0;
+    if (failures > 0) cout << failures << " of " << scenes.size() << " scenes failed" << endl;
+    return failures > 0 ? 1 : 0;
 }
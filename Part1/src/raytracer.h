@@ -0,0 +1,101 @@
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+/*
+ * C API of libraytracer: render scenes in-process, without spawning
+ * raytracer.exe or going through image files.
+ *
+ *   rt_renderer* renderer = rt_renderer_create(0);
+ *   rt_scene* scene = rt_scene_create(text, length, error, sizeof(error));
+ *   rt_render(renderer, scene, 800, 800, RT_PIXEL_RGB8, pixels, 800 * 3, 0);
+ *   rt_scene_destroy(scene);
+ *   rt_renderer_destroy(renderer);
+ *
+ * Handles are opaque. Functions returning int return RT_OK or a negative
+ * rt_status. A scene is immutable except for its camera and depth: it may be
+ * rendered from several threads at once, but rt_scene_set_camera and
+ * rt_scene_set_max_depth must not run while the scene is being rendered.
+ * A renderer (thread pool) accepts renders from several threads at once.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define RT_API __declspec(dllexport)
+#else
+#define RT_API __attribute__((visibility("default")))
+#endif
+
+/* Version of this API; bumped on incompatible changes */
+#define RT_API_VERSION 1
+
+typedef struct rt_renderer rt_renderer;
+typedef struct rt_scene rt_scene;
+
+typedef enum rt_status {
+    RT_OK = 0,
+    RT_ERROR_ARGUMENT = -1,   /* null handle or buffer, bad size, format or camera */
+    RT_ERROR_INTERNAL = -2    /* out of memory or other failure */
+} rt_status;
+
+/* Pixel layouts of the caller's buffer (rows top to bottom) */
+typedef enum rt_pixel_format {
+    RT_PIXEL_RGB8 = 0,        /* 3 bytes per pixel, clamped */
+    RT_PIXEL_RGBA8 = 1,       /* 4 bytes per pixel, clamped, alpha 255 */
+    RT_PIXEL_RGB32F = 2       /* 3 floats per pixel, unclamped */
+} rt_pixel_format;
+
+/* rt_render flags */
+#define RT_RENDER_PACKETS 1u  /* trace primary rays in 4x4 packets */
+#define RT_RENDER_WAVEFRONT 2u  /* trace tiles in waves of rays sorted by material */
+
+/* Camera as in a scene file: eye and focal length (e), up and viewport
+   height (u), forward and viewport width (f; 0 = from the image aspect ratio) */
+typedef struct rt_camera {
+    float eye[3];
+    float forward[3];
+    float up[3];
+    float focal_length;
+    float viewport_width;
+    float viewport_height;
+} rt_camera;
+
+/* RT_API_VERSION of the loaded library */
+RT_API int rt_version(void);
+
+/* Renderer with thread_count render threads (0 = one per hardware thread);
+   NULL on failure */
+RT_API rt_renderer* rt_renderer_create(unsigned thread_count);
+RT_API void rt_renderer_destroy(rt_renderer* renderer);
+
+/* Parse and compile scene text (scene file syntax) from buffer. On failure
+   returns NULL and, if error is not NULL, writes a message of at most
+   error_size bytes including the terminating zero. */
+RT_API rt_scene* rt_scene_create(const char* text, size_t length, char* error, size_t error_size);
+
+/* Load a scene file: text scene or compiled .rtsb (mapped in place) */
+RT_API rt_scene* rt_scene_load(const char* path, char* error, size_t error_size);
+
+RT_API void rt_scene_destroy(rt_scene* scene);
+
+RT_API int rt_scene_get_camera(const rt_scene* scene, rt_camera* camera);
+RT_API int rt_scene_set_camera(rt_scene* scene, const rt_camera* camera);
+
+/* Reflection/refraction bounces traced after the primary hit (default 5);
+   deeper rays add black */
+RT_API int rt_scene_set_max_depth(rt_scene* scene, int max_depth);
+
+/* Render scene into the caller's buffer of height rows, each row_stride bytes
+   apart (at least width pixels of format). flags: RT_RENDER_* bits. */
+RT_API int rt_render(rt_renderer* renderer, const rt_scene* scene, int width, int height,
+                     rt_pixel_format format, void* pixels, size_t row_stride, unsigned flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif